@@ -0,0 +1,1094 @@
+#include "Automaton.h"
+#include "BinaryFormat.h"
+#include "Equivalence.h"
+#include "Export.h"
+#include "ExternalMinimizer.h"
+#include "Generators.h"
+#include "IncrementalMinimizer.h"
+#include "Layout.h"
+#include "MappedFile.h"
+#include "Matcher.h"
+#include "Product.h"
+#include "ResultCache.h"
+#include "Snapshot.h"
+#include "Stats.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Benchmark driver: generates synthetic DFAs, runs the processing pipeline phase by phase
+// and prints one CSV row per case. Run without arguments for the default sweep, or pick
+// a single case (useful for an isolated peak RSS figure) with the options below.
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// The benchmark DFAs always fit a matcher; stop the run if one does not
+static Matcher compileMatcher(const Automaton& dfa) {
+    Matcher matcher;
+    string error;
+    if (!Matcher::compile(dfa, matcher, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        exit(1);
+    }
+    return matcher;
+}
+
+static unique_ptr<const DfaSnapshot> buildSnapshot(const Automaton& dfa, uint64_t version) {
+    unique_ptr<const DfaSnapshot> snapshot;
+    string error;
+    if (!DfaSnapshot::build(dfa, version, snapshot, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        exit(1);
+    }
+    return snapshot;
+}
+
+static const char* GENERATORS[] = {"random", "chain", "comb", "debruijn", "unreachable", "redundant", "trie",
+                                    "sparse", "deadend"};
+
+static bool generate(const string& name, StateId states, size_t symbols, uint64_t seed, Automaton& out) {
+    if (name == "random") out = generateRandomDFA(states, symbols, seed);
+    else if (name == "chain") out = generateChainDFA(states, symbols);
+    else if (name == "comb") out = generateCombDFA(states, symbols);
+    else if (name == "debruijn") out = generateDeBruijnDFA(states, symbols);
+    else if (name == "unreachable") out = generateUnreachableDFA(states, states / 2, symbols, seed);
+    else if (name == "redundant") out = generateRedundantDFA(max<StateId>(1, states / 100), 100, symbols, seed);
+    else if (name == "trie") out = generateTrieDFA(states, symbols, seed);
+    else if (name == "deadend") out = generateDeadEndDFA(states, states / 4, symbols, seed);
+    else if (name == "sparse") out = generateSparseDFA(states, symbols, min<size_t>(symbols, 3), seed);
+    else return false;
+    return true;
+}
+
+static void printHeader() {
+    printf("generator,states,symbols,threads,reachable_states,minimal_states,"
+           "generate_s,complete_s,unreachable_s,dead_states,dead_s,hopcroft_s,parallel_s,"
+           "hopcroft_states_per_s,parallel_states_per_s,partial_s,partial_states,peak_rss_kb\n");
+}
+
+static void runCase(const string& name, StateId states, size_t symbols, unsigned threads, uint64_t seed) {
+    Automaton automaton;
+    auto start = chrono::steady_clock::now();
+    generate(name, states, symbols, seed, automaton);
+    double generateTime = secondsSince(start);
+    StateId generated = automaton.getNumStates();
+
+    start = chrono::steady_clock::now();
+    automaton.completeDFA();
+    double completeTime = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    if (automaton.hasUnreachableStates()) automaton.removeUnreachableStates();
+    double unreachableTime = secondsSince(start);
+    StateId reachable = automaton.getNumStates();
+
+    // Dead-state collapsing on its own; minimizeDFA() repeats it as its first step
+    Automaton copy = automaton;
+    start = chrono::steady_clock::now();
+    StateId dead = copy.collapseDeadStates();
+    double deadTime = secondsSince(start);
+
+    copy = automaton;
+    start = chrono::steady_clock::now();
+    Automaton minimized = automaton.minimizeDFA();
+    double hopcroftTime = secondsSince(start);
+
+    // Chains and combs need about one refinement round per spine state; skip hopeless cases
+    bool deep = name == "chain" || name == "comb";
+    bool runParallel = !(deep && reachable > 20000);
+    double parallelTime = 0;
+    if (runParallel) {
+        start = chrono::steady_clock::now();
+        Automaton parallel = copy.minimizeDFAParallel(threads);
+        parallelTime = secondsSince(start);
+    }
+
+    // Partial minimization works on the automaton as generated, before completion
+    generate(name, states, symbols, seed, copy);
+    start = chrono::steady_clock::now();
+    Automaton partial = copy.minimizePartialDFA();
+    double partialTime = secondsSince(start);
+
+    printf("%s,%u,%zu,%u,%u,%u,%.6f,%.6f,%.6f,%u,%.6f,%.6f,",
+           name.c_str(), generated, symbols, threads, reachable, minimized.getNumStates(),
+           generateTime, completeTime, unreachableTime, dead, deadTime, hopcroftTime);
+    if (runParallel) printf("%.6f,", parallelTime); else printf(",");
+    printf("%.0f,", reachable / max(hopcroftTime, 1e-9));
+    if (runParallel) printf("%.0f,", reachable / max(parallelTime, 1e-9)); else printf(",");
+    printf("%.6f,%u,", partialTime, partial.getNumStates());
+    printf("%ld\n", peakRssKb());
+    fflush(stdout);
+}
+
+// Matcher throughput: compile a minimized random DFA and time each scan mode over
+// random text drawn from its alphabet (with a newline roughly every 100 bytes for line mode)
+static void runMatchBench(StateId states, size_t symbols, size_t bytes, uint64_t seed) {
+    Automaton minimized = generateRandomDFA(states, symbols, seed).minimizeDFA();
+    Matcher matcher = compileMatcher(minimized);
+
+    string alphabet = generatorAlphabet(symbols);
+    vector<unsigned char> input(bytes);
+    mt19937_64 rng(seed);
+    for (size_t i = 0; i < bytes; ++i) {
+        input[i] = (unsigned char)alphabet[rng() % alphabet.size()];
+    }
+
+    printf("mode,states,symbols,matcher_states,bytes,seconds,gb_per_s,results\n");
+    auto report = [&](const char* mode, double seconds, size_t results) {
+        printf("%s,%u,%zu,%u,%zu,%.6f,%.3f,%zu\n", mode, states, symbols, matcher.getNumStates(),
+               bytes, seconds, bytes / max(seconds, 1e-9) / 1e9, results);
+        fflush(stdout);
+    };
+
+    auto start = chrono::steady_clock::now();
+    uint32_t state = matcher.feed(matcher.start(), input.data(), input.size());
+    report("feed", secondsSince(start), matcher.isAccepting(state) ? 1 : 0);
+
+    vector<uint64_t> positions;
+    positions.reserve(bytes / 2);
+    start = chrono::steady_clock::now();
+    matcher.findAccepts(matcher.start(), input.data(), input.size(), 0, positions);
+    report("accept_positions", secondsSince(start), positions.size());
+
+    for (size_t i = 0; i < bytes; ++i) {
+        if (rng() % 100 == 0) input[i] = '\n';
+    }
+    vector<uint64_t> lines;
+    start = chrono::steady_clock::now();
+    ScanState scan = matcher.beginLines();
+    matcher.scanLines(scan, input.data(), input.size(), lines);
+    matcher.finishLines(scan, lines);
+    report("lines", secondsSince(start), lines.size());
+}
+
+// Speculative parallel matching: time feedParallel() and findAcceptsParallel() over B
+// bytes of random text on 1, 2, 4, ... threads against the sequential runs, checking
+// that the final state and the accept positions are the same
+static void runSpeculativeBench(const string& name, StateId states, size_t symbols, size_t bytes,
+                                unsigned threads, uint64_t seed) {
+    Automaton automaton;
+    generate(name, states, symbols, seed, automaton);
+    if (automaton.hasUnreachableStates()) automaton.removeUnreachableStates();
+    Matcher matcher = compileMatcher(automaton.minimizeDFA());
+
+    string alphabet = generatorAlphabet(symbols);
+    vector<unsigned char> input(bytes);
+    mt19937_64 rng(seed);
+    for (size_t i = 0; i < bytes; ++i) input[i] = (unsigned char)alphabet[rng() % alphabet.size()];
+
+    auto start = chrono::steady_clock::now();
+    uint32_t expectedState = matcher.feed(matcher.start(), input.data(), input.size());
+    double feedTime = secondsSince(start);
+    vector<uint64_t> expected;
+    start = chrono::steady_clock::now();
+    matcher.findAccepts(matcher.start(), input.data(), input.size(), 0, expected);
+    double acceptTime = secondsSince(start);
+
+    printf("mode,generator,states,symbols,matcher_states,bytes,threads,seconds,gb_per_s,speedup,results,same\n");
+    auto report = [&](const char* mode, unsigned t, double seconds, double sequential, size_t results, bool same) {
+        printf("%s,%s,%u,%zu,%u,%zu,%u,%.6f,%.3f,%.2f,%zu,%d\n", mode, name.c_str(), states, symbols,
+               matcher.getNumStates(), bytes, t, seconds, bytes / max(seconds, 1e-9) / 1e9,
+               sequential / max(seconds, 1e-9), results, same);
+        fflush(stdout);
+    };
+    report("feed", 1, feedTime, feedTime, matcher.isAccepting(expectedState), true);
+    report("accept_positions", 1, acceptTime, acceptTime, expected.size(), true);
+    vector<uint64_t> positions;
+    positions.reserve(expected.size());
+    vector<unsigned> counts;
+    for (unsigned t = 2; t < threads; t *= 2) counts.push_back(t);
+    if (threads > 1) counts.push_back(threads);
+    for (unsigned t : counts) {
+        start = chrono::steady_clock::now();
+        uint32_t state = matcher.feedParallel(matcher.start(), input.data(), input.size(), t);
+        report("feed", t, secondsSince(start), feedTime, matcher.isAccepting(state), state == expectedState);
+
+        positions.clear();
+        start = chrono::steady_clock::now();
+        state = matcher.findAcceptsParallel(matcher.start(), input.data(), input.size(), 0, positions, t);
+        report("accept_positions", t, secondsSince(start), acceptTime, positions.size(),
+               state == expectedState && positions == expected);
+    }
+}
+
+// Regression for edits to the sink: on "contains an a" over {a, b}, delete an edge to
+// create the sink, then make it accepting (or give it an edge back to the accepting
+// state). Deleting the start state's 'a' edge afterwards must still leave the empty
+// language, so the deletion has to go to a fresh sink rather than the edited one.
+static bool checkIncrementalSinkEdits() {
+    for (int variant = 0; variant < 2; ++variant) {
+        Automaton containsA;
+        containsA.setVerbose(false);
+        containsA.setAlphabet("ab");
+        containsA.initStates(2);
+        containsA.setStartState(0);
+        containsA.setAccepting(1, true);
+        containsA.setTransition(0, 0, 1);
+        containsA.setTransition(0, 1, 0);
+        containsA.setTransition(1, 0, 1);
+        containsA.setTransition(1, 1, 1);
+        IncrementalMinimizer inc(containsA);
+
+        string error;
+        StateId start = inc.getStartState();
+        StateId accept = inc.getTransition(start, 'a');
+        bool ok = inc.removeTransition(accept, 'b', error);
+        StateId sink = inc.getTransition(accept, 'b');
+        ok = ok && (variant == 0 ? inc.setAccepting(sink, true, error) : inc.setTransition(sink, 'a', accept, error));
+        ok = ok && inc.removeTransition(start, 'a', error);
+        for (int pass = 0; pass < 2 && ok; ++pass) {
+            Automaton result = inc.toAutomaton();
+            for (const char* input : {"a", "ab", "ba", "aba"}) ok = ok && !acceptsString(result, input);
+            inc.update();
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// Incremental re-minimization: apply random edits one at a time to the minimized DFA,
+// calling update() after each. Edits copy another state's row (which creates merges),
+// redirect one transition, flip acceptance, or add or remove a state. With verifyEvery > 0
+// the result is checked against a full minimization every verifyEvery edits.
+static bool runIncrementalBench(const string& name, StateId states, size_t symbols,
+                                size_t edits, size_t verifyEvery, uint64_t seed) {
+    Automaton automaton;
+    generate(name, states, symbols, seed, automaton);
+    auto start = chrono::steady_clock::now();
+    IncrementalMinimizer inc(automaton);
+    double initTime = secondsSince(start);
+    StateId initialStates = inc.toAutomaton().getNumStates();
+
+    mt19937_64 rng(seed + 1);
+    const string& alphabet = inc.getSymbols();
+    auto randomState = [&]() {
+        while (true) {
+            StateId s = inc.resolve((StateId)(rng() % inc.getNumStates()));
+            if (s != NO_STATE) return s;
+        }
+    };
+
+    string error;
+    double updateTime = 0;
+    size_t merged = 0, checks = 0, failures = 0;
+    for (size_t e = 1; e <= edits; ++e) {
+        StateId a = randomState();
+        unsigned kind = rng() % 10;
+        if (kind < 2) {
+            StateId u = randomState();
+            inc.setAccepting(a, inc.isAccepting(u), error);
+            for (char symbol : alphabet) {
+                if (rng() % 8 == 0) continue;   // Leave some differences
+                inc.setTransition(a, symbol, inc.getTransition(u, symbol), error);
+            }
+        } else if (kind < 6) {
+            inc.setTransition(a, alphabet[rng() % alphabet.size()], randomState(), error);
+        } else if (kind < 8) {
+            inc.setAccepting(a, !inc.isAccepting(a), error);
+        } else if (rng() & 1) {
+            inc.removeState(a, error);   // Refused for the start and sink states
+        } else {
+            StateId q = inc.addState(rng() & 1);
+            inc.setTransition(q, alphabet[rng() % alphabet.size()], randomState(), error);
+            inc.setTransition(a, alphabet[rng() % alphabet.size()], q, error);
+        }
+
+        Automaton before;
+        if (verifyEvery && e % verifyEvery == 0) before = inc.toAutomaton();
+        start = chrono::steady_clock::now();
+        merged += inc.update();
+        updateTime += secondsSince(start);
+
+        if (verifyEvery && e % verifyEvery == 0) {
+            ++checks;
+            Automaton after = inc.toAutomaton();
+            bool equivalent = false;
+            string counterexample;
+            if (!checkEquivalence(before, after, equivalent, counterexample, error) || !equivalent
+                || after.getNumStates() != before.minimizeDFA().getNumStates()) {
+                ++failures;
+            }
+        }
+    }
+
+    Automaton finalDfa = inc.toAutomaton();
+    start = chrono::steady_clock::now();
+    finalDfa.minimizeDFA();
+    double fullTime = secondsSince(start);
+
+    bool sinkEditsOk = checkIncrementalSinkEdits();
+    printf("generator,states,symbols,edits,initial_states,final_states,init_s,update_s,"
+           "update_us_per_edit,full_minimize_s,merged,checks,check_failures,sink_edits_ok\n");
+    printf("%s,%u,%zu,%zu,%u,%u,%.6f,%.6f,%.2f,%.6f,%zu,%zu,%zu,%d\n",
+           name.c_str(), states, symbols, edits, initialStates, finalDfa.getNumStates(), initTime,
+           updateTime, updateTime * 1e6 / max<size_t>(edits, 1), fullTime, merged, checks, failures,
+           sinkEditsOk ? 1 : 0);
+    fflush(stdout);
+    if (failures || !sinkEditsOk) {
+        fprintf(stderr, "incremental check failed\n");
+        return false;
+    }
+    return true;
+}
+
+// Equivalence checking: compare a generated DFA with its minimized form (equivalent),
+// then with a copy of that form in which one state's acceptance is flipped
+static void runEquivalenceBench(const string& name, StateId states, size_t symbols, uint64_t seed) {
+    Automaton automaton;
+    generate(name, states, symbols, seed, automaton);
+    automaton.completeDFA();
+
+    Automaton work = automaton;
+    auto start = chrono::steady_clock::now();
+    Automaton minimized = work.minimizeDFA();
+    double minimizeTime = secondsSince(start);
+
+    string counterexample, error;
+    bool equivalent = false;
+    start = chrono::steady_clock::now();
+    if (!checkEquivalence(automaton, minimized, equivalent, counterexample, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return;
+    }
+    double equivalentTime = secondsSince(start);
+
+    // Flip a state reachable in the minimized DFA, so the languages really differ
+    mt19937_64 rng(seed + 1);
+    StateId flipped = (StateId)(rng() % minimized.getNumStates());
+    minimized.setAccepting(flipped, !minimized.isAccepting(flipped));
+    start = chrono::steady_clock::now();
+    bool mutatedEquivalent = false;
+    if (!checkEquivalence(automaton, minimized, mutatedEquivalent, counterexample, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return;
+    }
+    double mutatedTime = secondsSince(start);
+    bool witnessOk = !mutatedEquivalent &&
+                     acceptsString(automaton, counterexample) != acceptsString(minimized, counterexample);
+
+    printf("generator,states,symbols,minimal_states,minimize_s,equivalence_s,equivalent,"
+           "mutated_equivalence_s,mutated_equivalent,counterexample_length,counterexample_ok\n");
+    printf("%s,%u,%zu,%u,%.6f,%.6f,%d,%.6f,%d,%zu,%d\n",
+           name.c_str(), states, symbols, minimized.getNumStates(), minimizeTime, equivalentTime,
+           equivalent ? 1 : 0, mutatedTime, mutatedEquivalent ? 1 : 0, counterexample.size(),
+           witnessOk ? 1 : 0);
+    fflush(stdout);
+}
+
+// Lazy products of two generated DFAs (different seeds): explored pairs against the
+// eager n1 * n2, and partial minimization of each product
+static void runProductBench(const string& name, StateId states, size_t symbols, uint64_t seed) {
+    Automaton first, second;
+    generate(name, states, symbols, seed, first);
+    generate(name, states, symbols, seed + 1, second);
+    printf("generator,states,symbols,operation,eager_pairs,product_states,product_s,"
+           "minimal_states,minimize_s,peak_rss_kb\n");
+    const pair<const char*, ProductOperation> operations[] = {
+        {"intersection", ProductOperation::Intersection},
+        {"union", ProductOperation::Union},
+        {"difference", ProductOperation::Difference},
+    };
+    for (const auto& operation : operations) {
+        Automaton product;
+        string error;
+        auto start = chrono::steady_clock::now();
+        if (!buildProduct(first, second, operation.second, product, error)) {
+            fprintf(stderr, "%s: %s\n", operation.first, error.c_str());
+            continue;
+        }
+        double productTime = secondsSince(start);
+        StateId productStates = product.getNumStates();
+        start = chrono::steady_clock::now();
+        Automaton minimal = product.minimizePartialDFA();
+        double minimizeTime = secondsSince(start);
+        printf("%s,%u,%zu,%s,%llu,%u,%.6f,%u,%.6f,%ld\n", name.c_str(), states, symbols, operation.first,
+               (unsigned long long)first.getNumStates() * second.getNumStates(), productStates, productTime,
+               minimal.getNumStates(), minimizeTime, peakRssKb());
+        fflush(stdout);
+    }
+}
+
+// Subset construction: determinize a generated NFA, then minimize the result as a
+// partial DFA (the determinized DFA has no sink)
+static void runNfaBench(const string& name, StateId states, size_t symbols, uint64_t seed) {
+    auto start = chrono::steady_clock::now();
+    Nfa nfa = name == "suffix" ? generateSuffixNFA(states) : generateKeywordNFA(states, symbols, seed);
+    double generateTime = secondsSince(start);
+
+    Automaton dfa;
+    string error;
+    start = chrono::steady_clock::now();
+    if (!nfa.determinize(dfa, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return;
+    }
+    double determinizeTime = secondsSince(start);
+    StateId dfaStates = dfa.getNumStates();
+
+    start = chrono::steady_clock::now();
+    Automaton minimal = dfa.minimizePartialDFA();
+    double minimizeTime = secondsSince(start);
+
+    printf("generator,nfa_states,nfa_moves,symbols,columns,generate_s,dfa_states,determinize_s,"
+           "dfa_states_per_s,minimal_states,minimize_s,peak_rss_kb\n");
+    printf("%s,%u,%zu,%zu,%zu,%.6f,%u,%.6f,%.0f,%u,%.6f,%ld\n", name.c_str(), nfa.getNumStates(),
+           nfa.getNumMoves(), nfa.getAlphabet().size(), nfa.getNumColumns(), generateTime, dfaStates,
+           determinizeTime, dfaStates / max(determinizeTime, 1e-9), minimal.getNumStates(), minimizeTime,
+           peakRssKb());
+    fflush(stdout);
+}
+
+// Export throughput: minimize a generated DFA, then write it in every export format to a
+// temporary file, next to the minimization time for scale
+static void runExportBench(const string& name, StateId states, size_t symbols, uint64_t seed) {
+    Automaton automaton;
+    generate(name, states, symbols, seed, automaton);
+    automaton.completeDFA();
+    MinimizeScratch scratch;
+    auto start = chrono::steady_clock::now();
+    automaton.minimizeInPlace(scratch);
+    double minimizeTime = secondsSince(start);
+
+    printf("generator,states,symbols,minimal_states,minimize_s,format,bytes,export_s,mb_per_s\n");
+    const pair<const char*, ExportFormat> formats[] = {
+        {"table", ExportFormat::Table},
+        {"text", ExportFormat::Text},
+        {"csv", ExportFormat::Csv},
+        {"dot", ExportFormat::Dot},
+    };
+    for (const auto& format : formats) {
+        FILE* file = tmpfile();
+        if (!file) {
+            fprintf(stderr, "cannot create a temporary file\n");
+            return;
+        }
+        start = chrono::steady_clock::now();
+        {
+            OutputBuffer out(file);
+            exportAutomaton(automaton, format.second, out);
+        }
+        double exportTime = secondsSince(start);
+        long bytes = ftell(file);
+        fclose(file);
+        printf("%s,%u,%zu,%u,%.6f,%s,%ld,%.6f,%.1f\n", name.c_str(), states, symbols,
+               automaton.getNumStates(), minimizeTime, format.first, bytes, exportTime,
+               bytes / 1e6 / max(exportTime, 1e-9));
+        fflush(stdout);
+    }
+}
+
+// Out-of-core minimization: save a generated DFA in the binary format, minimize it from
+// the file within the memory budget and compare with minimizeDFA() in memory
+static void runExternalBench(const string& name, StateId states, size_t symbols, uint64_t budgetMiB,
+                             uint64_t seed) {
+    Automaton automaton;
+    generate(name, states, symbols, seed, automaton);
+    const string directory = filesystem::temp_directory_path().string();
+    const string inputPath = directory + "/dfa_bench_external_in.bin";
+    const string outputPath = directory + "/dfa_bench_external_out.bin";
+    string error;
+    if (!saveAutomatonBinary(automaton, inputPath, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return;
+    }
+
+    ExternalStats stats;
+    auto start = chrono::steady_clock::now();
+    bool ok = minimizeExternal(inputPath, outputPath, budgetMiB << 20, stats, error);
+    double externalTime = secondsSince(start);
+    remove(inputPath.c_str());
+    remove(outputPath.c_str());
+    if (!ok) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return;
+    }
+
+    start = chrono::steady_clock::now();
+    if (automaton.hasUnreachableStates()) automaton.removeUnreachableStates();
+    Automaton minimized = automaton.minimizeDFA();
+    double memoryTime = secondsSince(start);
+
+    printf("generator,states,symbols,budget_bytes,required_bytes,resident_bytes,minimal_states,"
+           "in_memory_states,rounds,table_passes,runs_spilled,merge_passes,bytes_read,bytes_written,"
+           "external_s,in_memory_s,peak_rss_kb\n");
+    printf("%s,%u,%zu,%llu,%llu,%llu,%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%.6f,%.6f,%ld\n", name.c_str(),
+           states, symbols, (unsigned long long)(budgetMiB << 20), (unsigned long long)stats.requiredBytes,
+           (unsigned long long)stats.residentBytes, stats.minimalStates, minimized.getNumStates(),
+           (unsigned long long)stats.rounds, (unsigned long long)stats.tablePasses,
+           (unsigned long long)stats.runsSpilled, (unsigned long long)stats.mergePasses,
+           (unsigned long long)stats.bytesRead, (unsigned long long)stats.bytesWritten, externalTime,
+           memoryTime, peakRssKb());
+    fflush(stdout);
+}
+
+// Result cache: time the input key, minimization plus canonical form and the stores,
+// then the lookups that replace minimization for an unchanged input, in memory and from
+// files in a temporary directory
+static void runCacheBench(const string& name, StateId states, size_t symbols, uint64_t seed) {
+    Automaton automaton;
+    generate(name, states, symbols, seed, automaton);
+    const string directory = (filesystem::temp_directory_path() / "dfa_bench_cache").string();
+    filesystem::remove_all(directory);
+    filesystem::create_directories(directory);
+
+    auto start = chrono::steady_clock::now();
+    Hash128 key = ResultCache::key(automaton, false);
+    double keyTime = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    Automaton minimized = automaton;
+    if (minimized.hasUnreachableStates()) minimized.removeUnreachableStates();
+    MinimizeScratch scratch;
+    minimized.minimizeInPlace(scratch);
+    double minimizeTime = secondsSince(start);
+    start = chrono::steady_clock::now();
+    minimized.canonicalize();
+    double canonicalTime = secondsSince(start);
+
+    string error;
+    ResultCache memoryCache, diskCache(directory);
+    start = chrono::steady_clock::now();
+    bool stored = diskCache.insert(key, minimized, error);
+    double storeTime = secondsSince(start);
+    memoryCache.insert(key, minimized, error);
+
+    Automaton found;
+    start = chrono::steady_clock::now();
+    bool memoryHit = memoryCache.find(ResultCache::key(automaton, false), found);
+    double memoryHitTime = secondsSince(start);
+    // A fresh cache on the same directory, as the next run would open it
+    ResultCache nextRun(directory);
+    start = chrono::steady_clock::now();
+    bool diskHit = nextRun.find(ResultCache::key(automaton, false), found);
+    double diskHitTime = secondsSince(start);
+    bool same = diskHit && hashAutomaton(found) == hashAutomaton(minimized);
+    filesystem::remove_all(directory);
+
+    printf("generator,states,symbols,minimal_states,key_s,minimize_s,canonicalize_s,store_s,stored,"
+           "memory_hit_s,memory_hit,disk_hit_s,disk_hit,identical,speedup\n");
+    printf("%s,%u,%zu,%u,%.6f,%.6f,%.6f,%.6f,%d,%.6f,%d,%.6f,%d,%d,%.1f\n", name.c_str(), states, symbols,
+           minimized.getNumStates(), keyTime, minimizeTime, canonicalTime, storeTime, stored, memoryHitTime,
+           memoryHit, diskHitTime, diskHit, same, (keyTime + minimizeTime) / max(diskHitTime, 1e-9));
+    fflush(stdout);
+}
+
+// State layout: renumber the minimized DFA in each StateOrder and time a restarting scan
+// over a trace with the hardware cache-miss count. The trace is a file, or text whose
+// symbols follow a Zipf distribution so that some paths are much hotter than others.
+// The profile order is learned from the first 1/16 of the trace and measured on all of it.
+static void runLayoutBench(const string& name, StateId states, size_t symbols, const string& tracePath,
+                           size_t bytes, uint64_t seed) {
+    Automaton automaton;
+    generate(name, states, symbols, seed, automaton);
+    if (automaton.hasUnreachableStates()) automaton.removeUnreachableStates();
+    Automaton minimized = automaton.minimizeDFA();
+
+    MappedFile file;
+    vector<unsigned char> generated;
+    const unsigned char* trace;
+    size_t length;
+    if (!tracePath.empty()) {
+        string error;
+        if (!file.open(tracePath, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return;
+        }
+        trace = file.bytes();
+        length = file.size();
+    } else {
+        string alphabet = generatorAlphabet(symbols);
+        vector<double> weights(alphabet.size());
+        for (size_t i = 0; i < weights.size(); ++i) weights[i] = 1.0 / ((i + 1) * (i + 1));
+        discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        mt19937_64 rng(seed);
+        generated.resize(bytes);
+        for (unsigned char& c : generated) c = (unsigned char)alphabet[pick(rng)];
+        trace = generated.data();
+        length = generated.size();
+    }
+
+    vector<uint64_t> visits = profileStateVisits(minimized, trace, length / 16);
+    // States that take 99% of the sampled steps
+    vector<uint64_t> sorted(visits);
+    sort(sorted.rbegin(), sorted.rend());
+    uint64_t totalVisits = 0, covered = 0;
+    for (uint64_t v : sorted) totalVisits += v;
+    size_t hotStates = 0;
+    while (hotStates < sorted.size() && covered * 100 < totalVisits * 99) covered += sorted[hotStates++];
+
+    printf("order,generator,states,symbols,matcher_states,trace_bytes,hot_states,reorder_s,scan_s,mb_per_s,"
+           "cache_misses,misses_per_kb,accepts,same\n");
+    uint64_t expectedAccepts = 0;
+    const char* ORDERS[] = {"minimized", "bfs", "dfs", "profile"};
+    for (const char* orderName : ORDERS) {
+        Automaton layout = minimized;
+        auto start = chrono::steady_clock::now();
+        StateOrder order;
+        if (parseStateOrder(orderName, order)) reorderStates(layout, order, visits);
+        double reorderTime = secondsSince(start);
+        Matcher matcher = compileMatcher(layout);
+
+        // Restart after a rejection, like profileStateVisits
+        CacheMissCounter misses;
+        start = chrono::steady_clock::now();
+        misses.start();
+        uint32_t state = matcher.start();
+        uint64_t accepts = 0;
+        for (size_t i = 0; i < length; ++i) {
+            state = matcher.step(state, trace[i]);
+            if (state == Matcher::rejectState()) state = matcher.start();
+            accepts += matcher.isAccepting(state);
+        }
+        long long missCount = misses.stop();
+        double scanTime = secondsSince(start);
+        if (orderName == ORDERS[0]) expectedAccepts = accepts;
+
+        printf("%s,%s,%u,%zu,%u,%zu,%zu,%.6f,%.6f,%.1f,%lld,", orderName, name.c_str(), states, symbols,
+               matcher.getNumStates(), length, hotStates, reorderTime, scanTime, length / max(scanTime, 1e-9) / 1e6,
+               missCount);
+        if (missCount >= 0) printf("%.3f,", missCount * 1024.0 / max<size_t>(length, 1)); else printf(",");
+        printf("%llu,%d\n", (unsigned long long)accepts, accepts == expectedAccepts);
+        fflush(stdout);
+    }
+}
+
+// Read latencies in 16 buckets per power of two, so percentiles are within 1/16
+struct LatencyHistogram {
+    vector<uint64_t> counts = vector<uint64_t>(64 * 16, 0);
+    uint64_t total = 0;
+    uint64_t maxNs = 0;
+
+    static size_t bucketOf(uint64_t ns) {
+        int e = 63 - __builtin_clzll(ns | 1);
+        return e < 4 ? (size_t)ns : (size_t)e * 16 + ((ns >> (e - 4)) & 15);
+    }
+    // Largest latency that falls into bucket i
+    static uint64_t bucketLimit(size_t i) {
+        if (i < 16) return i;
+        int e = (int)(i / 16);
+        return ((16 + i % 16 + 1) << (e - 4)) - 1;
+    }
+    void add(uint64_t ns) {
+        ++counts[bucketOf(ns)];
+        ++total;
+        maxNs = max(maxNs, ns);
+    }
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+        total += other.total;
+        maxNs = max(maxNs, other.maxNs);
+    }
+    uint64_t percentile(double q) const {
+        uint64_t rank = (uint64_t)(q * total), seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen > rank) return min(bucketLimit(i), maxNs);
+        }
+        return maxNs;
+    }
+};
+
+// Hot swap stress test: reader threads match probe strings in a loop while the writer
+// publishes `swaps` rebuilt rule sets, cycling through minimized DFAs from four seeds.
+// Each read checks its verdict against the verdict precomputed for the version it got,
+// that the snapshot it holds is still the one built for that version, and that versions
+// never go backwards. At the end every replaced snapshot must have been reclaimed.
+// Runs once with snapshots published through SnapshotPublisher and once the old way,
+// copying the matcher under a reader-writer lock. Returns false if any check failed.
+static bool runHotSwapBench(const string& name, StateId states, size_t symbols, unsigned readers,
+                            size_t swaps, uint64_t seed) {
+    const size_t VERSIONS = 4;
+    const size_t PROBES = 256;
+    vector<Automaton> rules(VERSIONS);
+    for (size_t v = 0; v < VERSIONS; ++v) {
+        Automaton automaton;
+        generate(name, states, symbols, seed + v, automaton);
+        if (automaton.hasUnreachableStates()) automaton.removeUnreachableStates();
+        rules[v] = automaton.minimizeDFA();
+    }
+    string alphabet = generatorAlphabet(symbols);
+    mt19937_64 rng(seed);
+    vector<string> probes(PROBES);
+    for (string& probe : probes) {
+        probe.resize(1 + rng() % 64);
+        for (char& c : probe) c = alphabet[rng() % alphabet.size()];
+    }
+    vector<vector<char>> expected(VERSIONS, vector<char>(PROBES));
+    vector<uint32_t> matcherStates(VERSIONS);
+    for (size_t v = 0; v < VERSIONS; ++v) {
+        Matcher matcher = compileMatcher(rules[v]);
+        matcherStates[v] = matcher.getNumStates();
+        for (size_t p = 0; p < PROBES; ++p) {
+            expected[v][p] = matcher.matches((const unsigned char*)probes[p].data(), probes[p].size());
+        }
+    }
+
+    printf("mode,generator,states,symbols,matcher_states,readers,swaps,reads,reads_per_s,p50_ns,p99_ns,"
+           "p999_ns,max_ns,swap_max_ns,mismatches,regressions,invalid,reclaimed,pending\n");
+    bool ok = true;
+    for (int locked = 0; locked < 2; ++locked) {
+        SnapshotPublisher publisher(buildSnapshot(rules[0], 0));
+        shared_mutex lock;
+        Matcher lockedMatcher = compileMatcher(rules[0]);
+        uint64_t lockedVersion = 0;
+
+        atomic<bool> stop(false);
+        vector<LatencyHistogram> latencies(readers);
+        vector<uint64_t> mismatches(readers, 0), regressions(readers, 0), invalid(readers, 0);
+        auto read = [&](unsigned r) {
+            SnapshotReader reader(publisher);
+            uint64_t lastVersion = 0;
+            for (size_t i = r; !stop.load(memory_order_relaxed); ++i) {
+                const string& probe = probes[i % PROBES];
+                const unsigned char* data = (const unsigned char*)probe.data();
+                uint64_t version;
+                bool accepted;
+                uint32_t matcherSize;
+                auto start = chrono::steady_clock::now();
+                if (locked) {
+                    shared_lock<shared_mutex> guard(lock);
+                    version = lockedVersion;
+                    accepted = lockedMatcher.matches(data, probe.size());
+                    matcherSize = lockedMatcher.getNumStates();
+                } else {
+                    PinnedSnapshot snapshot(reader);
+                    version = snapshot->getVersion();
+                    accepted = snapshot->matches(data, probe.size());
+                    // Read again after the match: a snapshot freed or replaced while
+                    // pinned would no longer describe the version it started with
+                    matcherSize = snapshot->getMatcher().getNumStates();
+                    if (snapshot->getVersion() != version) ++invalid[r];
+                }
+                latencies[r].add((uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - start).count());
+                if (version > swaps || matcherSize != matcherStates[version % VERSIONS]) ++invalid[r];
+                if (accepted != (bool)expected[version % VERSIONS][i % PROBES]) ++mismatches[r];
+                if (version < lastVersion) ++regressions[r];
+                lastVersion = version;
+            }
+        };
+
+        vector<thread> pool;
+        for (unsigned r = 0; r < readers; ++r) pool.emplace_back(read, r);
+        auto start = chrono::steady_clock::now();
+        uint64_t swapMaxNs = 0;
+        for (size_t i = 1; i <= swaps; ++i) {
+            // The rebuild happens outside the swap in both modes; only the swap is timed
+            const Automaton& next = rules[i % VERSIONS];
+            if (locked) {
+                Matcher built = compileMatcher(next);
+                auto swapStart = chrono::steady_clock::now();
+                {
+                    unique_lock<shared_mutex> guard(lock);
+                    lockedMatcher = built;
+                    lockedVersion = i;
+                }
+                swapMaxNs = max<uint64_t>(swapMaxNs, chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - swapStart).count());
+            } else {
+                unique_ptr<const DfaSnapshot> built = buildSnapshot(next, i);
+                auto swapStart = chrono::steady_clock::now();
+                publisher.publish(move(built));
+                swapMaxNs = max<uint64_t>(swapMaxNs, chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - swapStart).count());
+            }
+            this_thread::sleep_for(chrono::microseconds(500));
+        }
+        stop = true;
+        for (thread& t : pool) t.join();
+        double seconds = secondsSince(start);
+
+        LatencyHistogram all;
+        uint64_t mismatchCount = 0, regressionCount = 0, invalidCount = 0;
+        for (unsigned r = 0; r < readers; ++r) {
+            all.merge(latencies[r]);
+            mismatchCount += mismatches[r];
+            regressionCount += regressions[r];
+            invalidCount += invalid[r];
+        }
+        // With the readers gone every snapshot but the current one must be freed: one per
+        // publish. The locked mode has nothing to reclaim.
+        size_t pending = publisher.reclaim();
+        uint64_t reclaimed = locked ? swaps : publisher.getReclaimed();
+        printf("%s,%s,%u,%zu,%u,%u,%zu,%llu,%.0f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%zu\n",
+               locked ? "locked_copy" : "snapshot", name.c_str(), states, symbols, lockedMatcher.getNumStates(),
+               readers, swaps, (unsigned long long)all.total, all.total / max(seconds, 1e-9),
+               (unsigned long long)all.percentile(0.5), (unsigned long long)all.percentile(0.99),
+               (unsigned long long)all.percentile(0.999), (unsigned long long)all.maxNs,
+               (unsigned long long)swapMaxNs, (unsigned long long)mismatchCount,
+               (unsigned long long)regressionCount, (unsigned long long)invalidCount,
+               (unsigned long long)reclaimed, pending);
+        fflush(stdout);
+        if (mismatchCount || regressionCount || invalidCount || pending || reclaimed != swaps
+            || (!locked && publisher.getEpoch() != swaps + 1)) {
+            fprintf(stderr, "%s: hot swap check failed\n", locked ? "locked_copy" : "snapshot");
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--generator NAME] [--states N] [--symbols K] [--threads T] [--seed S]\n"
+            "       %s --match [--states N] [--symbols K] [--bytes B] [--seed S]\n"
+            "       %s --speculative [--generator NAME] [--states N] [--symbols K] [--bytes B] [--threads T]\n"
+            "          [--seed S]\n"
+            "       %s --incremental [--generator NAME] [--states N] [--symbols K] [--edits E]\n"
+            "          [--verify V] [--seed S]\n"
+            "       %s --equivalence [--generator NAME] [--states N] [--symbols K] [--seed S]\n"
+            "       %s --product [--generator NAME] [--states N] [--symbols K] [--seed S]\n"
+            "       %s --nfa [--generator keywords|suffix] [--states N] [--symbols K] [--seed S]\n"
+            "       %s --export [--generator NAME] [--states N] [--symbols K] [--seed S]\n"
+            "       %s --cache [--generator NAME] [--states N] [--symbols K] [--seed S]\n"
+            "       %s --external [--generator NAME] [--states N] [--symbols K] [--budget MIB] [--seed S]\n"
+            "       %s --layout [--generator NAME] [--states N] [--symbols K] [--trace FILE] [--bytes B]\n"
+            "          [--seed S]\n"
+            "       %s --hotswap [--generator NAME] [--states N] [--symbols K] [--threads T] [--swaps W]\n"
+            "          [--seed S]\n"
+            "  Without --generator, sweeps every generator over a range of sizes.\n"
+            "  --match measures matcher throughput over B bytes of random text instead.\n"
+            "  --speculative times the parallel speculative runs (default generator: random,\n"
+            "  N = 1000) over B bytes on 1, 2, 4, ... T threads against the sequential runs.\n"
+            "  --incremental times update() over E random edits (default generator: trie),\n"
+            "  checking against a full minimization every V edits (0 = never).\n"
+            "  --equivalence times checkEquivalence against minimization (default generator:\n"
+            "  redundant), on an equivalent pair and on a pair that differs in one state.\n"
+            "  --product builds the intersection, union and difference of two DFAs from\n"
+            "  different seeds (default generator: trie) and minimizes them as partial DFAs.\n"
+            "  --nfa determinizes a generated NFA of about N states (default generator:\n"
+            "  keywords with N = 10000; suffix, with N = 21, has a 2^(N-1)-state DFA) and\n"
+            "  minimizes the result.\n"
+            "  --export times writing the minimized DFA (default generator: random) as a\n"
+            "  table, text edge list, CSV and DOT.\n"
+            "  --cache times the result cache (default generator: redundant): the input key,\n"
+            "  minimization with canonical numbering, and lookups in memory and on disk.\n"
+            "  --external minimizes the DFA (default generator: redundant) out of core from a\n"
+            "  binary file within MIB mebibytes (default 64) and compares with minimizeDFA().\n"
+            "  --layout renumbers the minimized DFA (default generator: random, N = 1000000)\n"
+            "  in each state order and times a scan over the trace FILE or B bytes (default\n"
+            "  64 MiB) of Zipf-distributed text, with the hardware cache-miss count.\n"
+            "  --hotswap runs T reader threads matching while W rule reloads (default 200) are\n"
+            "  published (default generator: random), with snapshots and with a locked copy,\n"
+            "  and reports read latency percentiles and any inconsistent read.\n"
+            "  Generators: random chain comb debruijn unreachable redundant trie sparse deadend\n",
+            program, program, program, program, program, program, program, program, program, program, program,
+            program);
+}
+
+int main(int argc, char* argv[]) {
+    string generator;
+    StateId states = 100000;
+    bool statesGiven = false;
+    size_t symbols = 2;
+    unsigned threads = 0;
+    uint64_t seed = 1;
+    size_t bytes = (size_t)256 << 20;
+    bool bytesGiven = false;
+    string tracePath;
+    size_t edits = 1000;
+    size_t verifyEvery = 0;
+    bool match = false;
+    bool incremental = false;
+    bool equivalence = false;
+    bool product = false;
+    bool nfa = false;
+    bool exportMode = false;
+    bool external = false;
+    bool cacheMode = false;
+    bool hotSwap = false;
+    bool layout = false;
+    bool speculative = false;
+    uint64_t budgetMiB = 64;
+    size_t swaps = 200;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--match") { match = true; continue; }
+        if (arg == "--incremental") { incremental = true; continue; }
+        if (arg == "--equivalence") { equivalence = true; continue; }
+        if (arg == "--product") { product = true; continue; }
+        if (arg == "--nfa") { nfa = true; continue; }
+        if (arg == "--export") { exportMode = true; continue; }
+        if (arg == "--external") { external = true; continue; }
+        if (arg == "--cache") { cacheMode = true; continue; }
+        if (arg == "--hotswap") { hotSwap = true; continue; }
+        if (arg == "--layout") { layout = true; continue; }
+        if (arg == "--speculative") { speculative = true; continue; }
+        if (i + 1 >= argc) { printUsage(argv[0]); return 1; }
+        if (arg == "--bytes") {
+            bytes = strtoull(argv[++i], nullptr, 10);
+            bytesGiven = true;
+        }
+        else if (arg == "--trace") tracePath = argv[++i];
+        else if (arg == "--edits") edits = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--verify") verifyEvery = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--swaps") swaps = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--budget") budgetMiB = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--generator") generator = argv[++i];
+        else if (arg == "--states") {
+            states = (StateId)strtoul(argv[++i], nullptr, 10);
+            statesGiven = true;
+        }
+        else if (arg == "--symbols") symbols = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--threads") threads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--seed") seed = strtoull(argv[++i], nullptr, 10);
+        else { printUsage(argv[0]); return 1; }
+    }
+
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+
+    // The library reports progress on cout; keep the CSV on stdout clean
+    cout.rdbuf(nullptr);
+
+    if (match) {
+        runMatchBench(states, symbols, bytes, seed);
+        return 0;
+    }
+
+    if (speculative) {
+        Automaton probe;
+        if (generator.empty()) generator = "random";
+        if (!statesGiven) states = 1000;
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runSpeculativeBench(generator, states, symbols, bytes, threads, seed);
+        return 0;
+    }
+
+    if (incremental) {
+        Automaton probe;
+        if (generator.empty()) generator = "trie";
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return runIncrementalBench(generator, states, symbols, edits, verifyEvery, seed) ? 0 : 2;
+    }
+
+    if (equivalence) {
+        Automaton probe;
+        if (generator.empty()) generator = "redundant";
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runEquivalenceBench(generator, states, symbols, seed);
+        return 0;
+    }
+
+    if (product) {
+        Automaton probe;
+        if (generator.empty()) generator = "trie";
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runProductBench(generator, states, symbols, seed);
+        return 0;
+    }
+
+    if (exportMode) {
+        Automaton probe;
+        if (generator.empty()) generator = "random";
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runExportBench(generator, states, symbols, seed);
+        return 0;
+    }
+
+    if (cacheMode) {
+        Automaton probe;
+        if (generator.empty()) generator = "redundant";
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runCacheBench(generator, states, symbols, seed);
+        return 0;
+    }
+
+    if (layout) {
+        Automaton probe;
+        if (generator.empty()) generator = "random";
+        if (!statesGiven) states = 1000000;
+        if (!bytesGiven) bytes = (size_t)64 << 20;
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runLayoutBench(generator, states, symbols, tracePath, bytes, seed);
+        return 0;
+    }
+
+    if (hotSwap) {
+        Automaton probe;
+        if (generator.empty()) generator = "random";
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return runHotSwapBench(generator, states, symbols, threads, swaps, seed) ? 0 : 2;
+    }
+
+    if (external) {
+        Automaton probe;
+        if (generator.empty()) generator = "redundant";
+        if (states < 1 || budgetMiB == 0 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runExternalBench(generator, states, symbols, budgetMiB, seed);
+        return 0;
+    }
+
+    if (nfa) {
+        if (generator.empty()) generator = "keywords";
+        // Every keyword set holds the start closure, so the default size is much smaller
+        if (!statesGiven) states = generator == "suffix" ? 21 : 10000;
+        if (states < 2 || (generator != "keywords" && generator != "suffix")) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runNfaBench(generator, states, symbols, seed);
+        return 0;
+    }
+
+    printHeader();
+    if (!generator.empty()) {
+        Automaton probe;
+        if (states < 1 || !generate(generator, 1, 1, seed, probe)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        runCase(generator, states, symbols, threads, seed);
+        return 0;
+    }
+
+    const StateId sweepStates[] = {1000, 10000, 100000, 1000000};
+    const size_t sweepSymbols[] = {2, 8, 32};
+    for (const char* name : GENERATORS) {
+        for (StateId n : sweepStates) {
+            for (size_t k : sweepSymbols) {
+                if ((size_t)n * k > 8000000) continue;
+                runCase(name, n, k, threads, seed);
+            }
+        }
+    }
+    return 0;
+}
@@ -10,41 +10,164 @@
 #include <algorithm>
 #include <iomanip>
 #include <limits>
+#include <array>
+#include <cstdint>
 using namespace std;
 
+// Dense state identifier: states are numbered 0..numStates-1
+typedef uint32_t StateId;
+// Marks an undefined transition in the flat transition table
+const StateId NO_STATE = numeric_limits<StateId>::max();
+// Index of a block (equivalence class) during partition refinement
+typedef uint32_t BlockId;
+
+struct MinimizeScratch;
+
 class Automaton {
 private:
-    set<char> alphabet;
-    int numStates;
-    vector<string> states;
-    string startState;
-    set<string> acceptingStates;
-    set<string> deadStates;   // Stores states designated as dead/sink states
-    map<string, map<char, set<string>>> transitions;
+    vector<char> alphabet;            // Symbols (sorted)
+    array<int, 256> symbolToColumn;   // Byte value -> column index, -1 if not in alphabet
+    size_t numColumns;                // Transition columns; equivalent symbols share one
+    StateId numStates;
+    vector<string> stateNames;        // Display names only ("q0", "qd", "Q1", ...)
+    StateId startState;
+    vector<bool> acceptingStates;
+    vector<bool> deadStates;          // Marks states designated as dead/sink states
+    vector<StateId> transitions;      // numStates x numColumns, row-major
     bool isDFA;
-   
+    bool verbose;                     // Print progress messages from the processing methods
+
+    // Reachability cache, valid until the states, start state or transitions change
+    vector<uint64_t> reachable;       // Bit s set if s can be reached from startState
+    StateId reachableCount;
+    bool reachabilityValid;
+
+    // Append a state with the given display name and an undefined row
+    StateId addState(const string& name);
+    // Look up a state by display name, NO_STATE if absent
+    StateId findState(const string& name) const;
+    // Fill the reachability cache by a frontier-at-a-time BFS from the start state
+    void computeReachability();
+    // Mark the states that can reach an accepting state, by a backward search from the
+    // accepting states over a predecessor index of the flat table; with reachableOnly,
+    // only states that are also reachable from the start state
+    void computeCoReachability(vector<bool>& live, bool reachableOnly);
+    // Merge the states of each block into one state (start block becomes Q0). States
+    // whose block is NO_STATE are dropped and transitions into them become undefined.
+    Automaton buildQuotient(const vector<BlockId>& blockOf, size_t numBlocks) const;
+    // Same, into `minimized` (reusing its buffers) with newStateOf as block -> state scratch
+    void buildQuotient(const vector<BlockId>& blockOf, size_t numBlocks, vector<StateId>& newStateOf,
+                       Automaton& minimized) const;
+    // Bodies of the public minimizers. If the automaton already is minimal it is returned
+    // as it is: moved out with `consume`, copied otherwise.
+    Automaton minimizeDFA(MinimizeScratch& scratch, bool consume);
+    Automaton minimizeDFAParallel(unsigned numThreads, bool consume);
+    Automaton minimizePartialDFA(bool consume);
+    // Collapse dead states, complete, compress the alphabet and run Hopcroft's refinement;
+    // the coarsest stable partition is left in scratch.partition. Returns the number of
+    // dead states removed before refinement.
+    StateId computeMinimalPartition(MinimizeScratch& scratch);
+
     // Utility function for power set construction/debugging
     string setToStateName(const set<string>& stateSet);
 
 public:
     Automaton();
-    
+
     // Input methods
     void inputAlphabet();
     void generateStates();
     void inputDeadStates();
     void inputAcceptingStates();
     void inputTransitions();
-    
+
+    // Non-interactive construction (used by the file loaders)
+    // One column per symbol
+    void setAlphabet(const string& symbols);
+    // Symbols with a non-negative entry form the alphabet; entries give their columns
+    void setAlphabetClasses(const array<int, 256>& columnOfSymbol);
+    // Replace all states with q0..q(count-1), every transition undefined
+    void initStates(StateId count);
+    void setStartState(StateId s) {
+        startState = s;
+        reachabilityValid = false;
+    }
+    void setStateName(StateId s, const string& name) { stateNames[s] = name; }
+    void setAccepting(StateId s, bool accepting) { acceptingStates[s] = accepting; }
+    void setDead(StateId s, bool dead) { deadStates[s] = dead; }
+    void setTransition(StateId s, size_t column, StateId dest) {
+        transitions[(size_t)s * numColumns + column] = dest;
+        reachabilityValid = false;
+    }
+    // Return the dead sink 'qd', adding it if it does not exist yet
+    StateId ensureDeadState();
+
     // Processing methods
+    // Progress messages are on by default; batch workers turn them off
+    void setVerbose(bool enabled) { verbose = enabled; }
     void DeadStateLogic();
     void removeUnreachableStates();
+    // Find the dead states, those that cannot reach an accepting state, by backward
+    // co-reachability and merge them: with keepSink into one self-looping sink marked
+    // dead that also takes every undefined transition, otherwise they are removed and
+    // transitions into them become undefined (a dead start state is kept as the lone
+    // rejecting state). Returns the number of states removed.
+    StateId collapseDeadStates(bool keepSink = true);
     void completeDFA();
     bool checkIfDFA();
-    Automaton minimizeDFA();
+    // Merge symbols whose columns are identical in every state into one column
+    void compressAlphabet();
+    // Undo compressAlphabet: one column per symbol again
+    void expandAlphabet();
+    // The minimizers return a new automaton and leave this one preprocessed but otherwise
+    // intact, so an automaton that already is minimal is returned as a copy. Call them on
+    // an rvalue (std::move(dfa).minimizeDFA()) when the input is not needed afterwards:
+    // it is then moved into the result instead, or use minimizeInPlace.
+    Automaton minimizeDFA() &;
+    Automaton minimizeDFA() &&;
+    // Same, reusing the buffers in scratch (see Partition.h)
+    Automaton minimizeDFA(MinimizeScratch& scratch) & { return minimizeDFA(scratch, false); }
+    Automaton minimizeDFA(MinimizeScratch& scratch) && { return minimizeDFA(scratch, true); }
+    // Minimize this automaton in place; returns false if it already was minimal, in which
+    // case nothing is copied. Once scratch has served an automaton of similar size, only
+    // small per-symbol temporaries are allocated.
+    bool minimizeInPlace(MinimizeScratch& scratch);
+    // Moore-style signature refinement spread over numThreads threads (0 = all cores);
+    // yields the same minimal DFA as minimizeDFA()
+    Automaton minimizeDFAParallel(unsigned numThreads = 0) & { return minimizeDFAParallel(numThreads, false); }
+    Automaton minimizeDFAParallel(unsigned numThreads = 0) && { return minimizeDFAParallel(numThreads, true); }
+    // Valmari-Lehtinen minimization of a partial DFA: missing transitions stay missing and
+    // act as an implicit sink, states that cannot reach an accepting state are dropped,
+    // and the work is proportional to the defined transitions. Returns a partial DFA.
+    Automaton minimizePartialDFA() & { return minimizePartialDFA(false); }
+    Automaton minimizePartialDFA() && { return minimizePartialDFA(true); }
     bool hasUnreachableStates();
+    // Renumber into canonical form: identical columns merged, classes ordered by their
+    // lowest symbol, states numbered Q0, Q1, ... breadth-first from the start state with
+    // successors taken in class order (unreachable states last, in their old order).
+    // Isomorphic automata, such as any two minimal DFAs of one language, become identical.
+    void canonicalize();
+    // Renumber the states so that state order[i] becomes state i (order must be a
+    // permutation of 0..numStates-1). Names, flags and the start state move with them.
+    void permuteStates(const vector<StateId>& order);
     // Display methods
     void displayTransitionTable(const string& title = "Transition Table");
+
+    // Read-only access to the dense representation
+    StateId getNumStates() const { return numStates; }
+    size_t getNumColumns() const { return numColumns; }
+    const vector<char>& getAlphabet() const { return alphabet; }
+    // Symbols that share a column, in ascending order
+    vector<char> getColumnSymbols(size_t column) const;
+    int getColumn(char symbol) const { return symbolToColumn[(unsigned char)symbol]; }
+    StateId getStartState() const { return startState; }
+    bool isAccepting(StateId s) const { return acceptingStates[s]; }
+    bool isDead(StateId s) const { return deadStates[s]; }
+    const string& getStateName(StateId s) const { return stateNames[s]; }
+    StateId getTransition(StateId s, size_t column) const {
+        return transitions[(size_t)s * numColumns + column];
+    }
+    const vector<StateId>& getTransitionTable() const { return transitions; }
 };
 
-#endif // AUTOMATON_H
\ No newline at end of file
+#endif // AUTOMATON_H
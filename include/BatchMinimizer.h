@@ -0,0 +1,36 @@
+#ifndef BATCH_MINIMIZER_H
+#define BATCH_MINIMIZER_H
+
+#include <cstdio>
+#include <string>
+#include "Loader.h"
+#include "ResultCache.h"
+using namespace std;
+
+struct BatchStats {
+    size_t records;   // Records read
+    size_t failed;    // Records that could not be loaded or determinized (reported in the output)
+    size_t cacheFailures;   // Results that could not be written to the cache directory
+};
+
+// Minimize every record of a text edge-list stream and write the minimized records to
+// `out` in input order, in the same format.
+//
+// The calling thread parses records; numThreads workers (0 = all cores) each own a job
+// deque and steal from the back of the others' deques when theirs runs dry. Every
+// worker keeps its minimization buffers across jobs. At most `window` records are in
+// flight (parsed but not yet written), which bounds memory, and finished records wait in
+// a reorder ring until everything before them has been written. A record that fails to
+// load is written as a "# record N: <error>" comment line and the batch goes on.
+// With `partial` the records are minimized as partial DFAs (minimizePartialDFA). NFA
+// records are determinized by the worker that minimizes them, not by the parsing thread.
+// With `canonical` the results are written in canonical form (Automaton::canonicalize).
+// With a `cache`, every result is looked up by its input's key before minimizing and
+// stored after, and the results are always canonical.
+// If the calling thread collects statistics (see Stats.h), the workers' are added to them.
+//
+// Returns false and sets `error` only if writing the output fails.
+bool minimizeBatch(Tokenizer& in, FILE* out, unsigned numThreads, size_t window,
+                   bool partial, bool canonical, ResultCache* cache, BatchStats& stats, string& error);
+
+#endif // BATCH_MINIMIZER_H
@@ -0,0 +1,75 @@
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+#include <cstdint>
+#include <string>
+#include "Automaton.h"
+#include "MappedFile.h"
+using namespace std;
+
+const uint32_t BINARY_FORMAT_VERSION = 1;
+const uint32_t BINARY_BYTE_ORDER_MARK = 0x01020304;
+// Header flag: states are named Q0, Q1, ... (a minimized automaton) rather than q0, q1, ...
+const uint32_t BINARY_FLAG_MINIMIZED_NAMES = 1;
+
+// Fixed-size header at the start of a binary automaton file. Offsets are from the
+// start of the file; the transition array starts on a 64-byte boundary so it can be
+// used in place once the file is mapped.
+struct BinaryHeader {
+    char magic[8];               // "DFABIN\r\n"
+    uint32_t version;
+    uint32_t byteOrder;          // BINARY_BYTE_ORDER_MARK in the writer's byte order
+    uint32_t numStates;
+    uint32_t numColumns;       // Number of transition columns
+    uint32_t startState;
+    uint32_t flags;
+    int16_t symbolToColumn[256]; // Byte value -> column, -1 if not in the alphabet
+    uint64_t acceptingOffset;    // numStates bits packed into 64-bit words
+    uint64_t deadOffset;         // Same layout as the accepting bitset
+    uint64_t transitionsOffset;  // numStates x numColumns StateId values, row-major
+    uint64_t fileSize;
+};
+static_assert(sizeof(BinaryHeader) % 64 == 0, "BinaryHeader must keep 64-byte alignment");
+
+// Read-only view of a binary automaton file. All accessors read straight from the
+// mapping; nothing is copied unless toAutomaton() is called.
+class MappedAutomaton {
+private:
+    MappedFile file;
+    const BinaryHeader* header;
+    const uint64_t* accepting;
+    const uint64_t* dead;
+    const StateId* transitions;
+
+public:
+    MappedAutomaton() : header(nullptr), accepting(nullptr), dead(nullptr), transitions(nullptr) {}
+
+    // Map the file and check the header and section bounds (not the transitions themselves)
+    bool open(const string& path, string& error);
+    // Check every transition target; touches the whole table
+    bool validate(string& error) const;
+    // Copy into a mutable Automaton
+    Automaton toAutomaton() const;
+
+    StateId getNumStates() const { return header->numStates; }
+    size_t getNumColumns() const { return header->numColumns; }
+    int getColumn(char symbol) const { return header->symbolToColumn[(unsigned char)symbol]; }
+    StateId getStartState() const { return header->startState; }
+    bool isAccepting(StateId s) const { return (accepting[s >> 6] >> (s & 63)) & 1; }
+    bool isDead(StateId s) const { return (dead[s >> 6] >> (s & 63)) & 1; }
+    StateId getTransition(StateId s, size_t column) const {
+        return transitions[(size_t)s * header->numColumns + column];
+    }
+    const StateId* getTransitionTable() const { return transitions; }
+    const BinaryHeader& getHeader() const { return *header; }
+};
+
+// Header for a file of the given size with every section offset filled in; the caller
+// sets symbolToColumn (all -1 here) and flags
+BinaryHeader makeBinaryHeader(StateId numStates, size_t numColumns, StateId startState);
+// Write the automaton in the binary format; on failure returns false and sets `error`
+bool saveAutomatonBinary(const Automaton& automaton, const string& path, string& error);
+// True if the file starts with the binary format's magic bytes
+bool isBinaryAutomatonFile(const string& path);
+
+#endif // BINARY_FORMAT_H
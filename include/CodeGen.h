@@ -0,0 +1,39 @@
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include <string>
+#include "Automaton.h"
+#include "Export.h"
+using namespace std;
+
+enum class CodeStyle {
+    // constexpr byte-class and transition tables with static_assert-checked dimensions;
+    // matches() is constexpr, so patterns can also be checked at compile time
+    Table,
+    // Direct-coded state machine: one label per state and a switch over the next byte
+    // that jumps to the successor, so no table is loaded at run time
+    Switch
+};
+
+// Parse "table" or "switch"
+bool parseCodeStyle(const string& name, CodeStyle& style);
+
+// Write a standalone C++17 header that matches the DFA's language, in namespace
+// `name`. The states are numbered like the Matcher's rows: 0 is the reject sink (which
+// also absorbs non-accepting states that only loop to themselves), then the
+// non-accepting states, then the accepting states, so acceptance is one comparison
+// against FIRST_ACCEPTING. Bytes outside the alphabet and undefined transitions reject.
+//
+// The header exposes NUM_STATES, START, FIRST_ACCEPTING, isAccepting() and
+// matches(std::string_view) / matches(const unsigned char*, size_t); the table style
+// also exposes step() for streaming use.
+//
+// Returns false and sets `error` if `name` is not a C++ identifier.
+bool generateCode(const Automaton& dfa, CodeStyle style, const string& name, OutputBuffer& out,
+                  string& error);
+
+// Same, into a file ("-" for stdout). The namespace is the file's base name with every
+// character that cannot appear in an identifier replaced by '_' ("dfa" for stdout).
+bool generateCodeFile(const Automaton& dfa, CodeStyle style, const string& path, string& error);
+
+#endif // CODEGEN_H
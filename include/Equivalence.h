@@ -0,0 +1,29 @@
+#ifndef EQUIVALENCE_H
+#define EQUIVALENCE_H
+
+#include <string>
+#include "Automaton.h"
+using namespace std;
+
+// Decide whether two DFAs accept the same language, without minimizing either.
+//
+// Hopcroft and Karp's algorithm: the start states are merged in a union-find structure
+// over the states of both automata, and every merged pair merges its successors on
+// each symbol. The automata are equivalent iff no merged pair disagrees on acceptance.
+// Pairs are visited breadth-first, so the first disagreement found lies at the end of
+// a shortest distinguishing string. Time is O((n1 + n2) * c * alpha(n)) for c joint
+// symbol classes.
+//
+// Symbols missing from one alphabet and undefined transitions go to an implicit
+// rejecting sink. Sets `equivalent` to whether the languages are equal; if not,
+// `counterexample` is a shortest string accepted by exactly one of the automata
+// (possibly the empty string).
+//
+// Returns false and sets `error` if the two automata have too many states for a StateId.
+bool checkEquivalence(const Automaton& first, const Automaton& second, bool& equivalent,
+                      string& counterexample, string& error);
+
+// Run the DFA over input; symbols outside the alphabet and undefined transitions reject
+bool acceptsString(const Automaton& dfa, const string& input);
+
+#endif // EQUIVALENCE_H
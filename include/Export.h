@@ -0,0 +1,86 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Automaton.h"
+using namespace std;
+
+// Write buffer for bulk output: text is collected in a fixed-size block that is handed
+// to the sink (a FILE*, an ostream or a string) whenever it fills up, so a rendering of
+// any size is streamed in constant memory. Integers are formatted by hand, two digits at
+// a time, instead of going through printf or iostream formatting.
+class OutputBuffer {
+private:
+    FILE* file;
+    ostream* stream;
+    string* target;
+    vector<char> buffer;
+    size_t len;
+    bool failed;
+
+    // Send bytes to the sink
+    void emit(const char* data, size_t size);
+    void drain() {
+        emit(buffer.data(), len);
+        len = 0;
+    }
+
+public:
+    explicit OutputBuffer(FILE* out, size_t capacity = 1 << 20);
+    explicit OutputBuffer(ostream& out, size_t capacity = 1 << 20);
+    // Appends to `out`
+    explicit OutputBuffer(string& out, size_t capacity = 1 << 16);
+    ~OutputBuffer() { flush(); }
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void write(const char* data, size_t size) {
+        if (buffer.size() - len < size) {
+            drain();
+            if (size > buffer.size()) {
+                emit(data, size);
+                return;
+            }
+        }
+        memcpy(buffer.data() + len, data, size);
+        len += size;
+    }
+    void write(const string& text) { write(text.data(), text.size()); }
+    void put(char c) {
+        if (len == buffer.size()) drain();
+        buffer[len++] = c;
+    }
+    void writeUnsigned(uint64_t value);
+    // `count` copies of c
+    void fill(char c, size_t count);
+
+    // Hand everything buffered to the sink; false once any write has failed
+    bool flush();
+};
+
+enum class ExportFormat {
+    Table,   // The aligned table printed by displayTransitionTable()
+    Text,    // The text edge-list format read by the loader (see Loader.h)
+    Csv,     // One row per state: id, name, start and accepting flags, one target id per column
+    Dot      // Graphviz digraph, parallel edges merged into one edge per target
+};
+
+// Parse "table", "text", "csv" or "dot"
+bool parseExportFormat(const string& name, ExportFormat& format);
+
+// Render the automaton in the given format. Rows are streamed through the buffer, so
+// only the per-column labels are held in memory besides the automaton itself. Undefined
+// transitions print as "-" in the table, an empty field in CSV and no edge in DOT.
+void exportAutomaton(const Automaton& automaton, ExportFormat format, OutputBuffer& out,
+                     const string& title = "Transition Table");
+
+// Export to a file ("-" for stdout); returns false and sets `error` if it cannot be written
+bool exportAutomatonFile(const Automaton& automaton, ExportFormat format, const string& path,
+                         string& error);
+
+#endif // EXPORT_H
@@ -0,0 +1,42 @@
+#ifndef EXTERNAL_MINIMIZER_H
+#define EXTERNAL_MINIMIZER_H
+
+#include <cstdint>
+#include <string>
+#include "Automaton.h"
+using namespace std;
+
+// Figures from one out-of-core minimization, for capacity planning
+struct ExternalStats {
+    StateId states;              // States in the input
+    StateId reachableStates;     // States reachable from the start
+    StateId minimalStates;       // States in the output
+    uint64_t rounds;             // Refinement rounds, one pass over the table each
+    uint64_t tablePasses;        // Passes over the input table, including the search and the output
+    uint64_t runsSpilled;        // Sorted runs written to spill files
+    uint64_t mergePasses;        // Extra passes that merged runs into longer runs
+    uint64_t bytesRead;          // From the input table and the spill files
+    uint64_t bytesWritten;       // To the spill files and the output file
+    uint64_t residentBytes;      // Largest total of the arrays and buffers held at once
+    uint64_t requiredBytes;      // Smallest budget this input could have been run with
+};
+
+// Minimize the binary automaton at inputPath (see BinaryFormat.h) into a binary file at
+// outputPath without loading it. The transition table stays in the mapped input file and
+// is read in sequential passes; only one block ID per state is kept in memory, and
+// everything else is held within memoryBudget bytes.
+//
+// Each round of Moore-style refinement streams over the table and emits, for every
+// reachable state, the record (block, blocks of its successors, state). Records are
+// sorted in runs that fill the budget, spilled to temporary files and merged; states
+// with equal signatures form the next round's blocks, each named by its lowest state.
+// Rounds stop when the number of blocks stops growing. Undefined transitions go to an
+// implicit sink that is added to the output only if no state is equivalent to it.
+//
+// The output has the same columns as the input and is numbered like minimizeDFA()'s
+// result: Q0 is the start block, the other blocks follow in order of their lowest state.
+// On failure returns false and sets `error`, e.g. if the budget cannot hold the block IDs.
+bool minimizeExternal(const string& inputPath, const string& outputPath, uint64_t memoryBudget,
+                      ExternalStats& stats, string& error);
+
+#endif // EXTERNAL_MINIMIZER_H
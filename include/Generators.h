@@ -0,0 +1,54 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <cstdint>
+#include <string>
+#include "Automaton.h"
+#include "Nfa.h"
+using namespace std;
+
+// Synthetic DFA generators for benchmarks. All generators are deterministic for a given
+// seed and return complete DFAs with start state 0.
+
+// The first numSymbols symbols of a-z, A-Z, 0-9, then the remaining byte values
+string generatorAlphabet(size_t numSymbols);
+
+// Every transition uniformly random, each state accepting with probability 1/2
+Automaton generateRandomDFA(StateId numStates, size_t numSymbols, uint64_t seed);
+// Linear chain on the first symbol ending in the only accepting state; every state is
+// distinguished, by strings as long as the chain (worst case for round-based refinement)
+Automaton generateChainDFA(StateId numStates, size_t numSymbols);
+// A spine on the first symbol with a one-state tooth per spine state on the second symbol;
+// teeth accept following the Thue-Morse sequence
+Automaton generateCombDFA(StateId numStates, size_t numSymbols);
+// Unary cycle whose accepting states spell a binary de Bruijn sequence, the classic
+// worst case for Hopcroft's algorithm (numStates is rounded down to a power of two)
+Automaton generateDeBruijnDFA(StateId numStates, size_t numSymbols);
+// Random DFA where only the first reachableStates states can be reached from the start;
+// the rest point anywhere
+Automaton generateUnreachableDFA(StateId numStates, StateId reachableStates, size_t numSymbols, uint64_t seed);
+// Random DFA whose states from liveStates on never accept and only lead to each other:
+// a dead region that every live state can fall into, to be collapsed into one sink
+Automaton generateDeadEndDFA(StateId numStates, StateId liveStates, size_t numSymbols, uint64_t seed);
+// Keyword trie: state s > 0 hangs off a random earlier state on one of its free symbols,
+// every missing edge goes to a final sink, leaves and some inner states accept. Acyclic
+// apart from the sink, like the DFA of a keyword list; many subtrees minimize together.
+Automaton generateTrieDFA(StateId numStates, size_t numSymbols, uint64_t seed);
+// Sparse random DFA: every state defines `defined` random symbols to random states and
+// leaves the rest undefined; about a quarter of the states accept
+Automaton generateSparseDFA(StateId numStates, size_t numSymbols, size_t defined, uint64_t seed);
+// `copies` interleaved copies of a random baseStates-state DFA, with each transition
+// going to a random copy of its target; minimizes to at most baseStates states
+Automaton generateRedundantDFA(StateId baseStates, StateId copies, size_t numSymbols, uint64_t seed);
+
+// NFA generators (the results are finished with Nfa::finishMoves()).
+//
+// Keyword search: a start state looping on every symbol, with an epsilon move into one
+// chain per random keyword (3 to 10 symbols) ending in an accepting state, until about
+// numStates states are used; the NFA of ".*(kw1|kw2|...)" as a rule compiler emits it
+Nfa generateKeywordNFA(StateId numStates, size_t numSymbols, uint64_t seed);
+// "The numStates-1'th symbol from the end is the first symbol" over the first two
+// symbols: numStates NFA states, 2^(numStates-1) DFA states (the classic blow-up)
+Nfa generateSuffixNFA(StateId numStates);
+
+#endif // GENERATORS_H
@@ -0,0 +1,47 @@
+#ifndef HASH128_H
+#define HASH128_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+struct Hash128 {
+    uint64_t low;
+    uint64_t high;
+
+    bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+    // 32 lowercase hex digits, high half first
+    string toHex() const;
+};
+
+// For unordered containers keyed by Hash128: the low half is already well mixed
+struct Hash128Hasher {
+    size_t operator()(const Hash128& hash) const { return (size_t)hash.low; }
+};
+
+// Streaming MurmurHash3 (x64, 128-bit variant): the input is consumed in 16-byte blocks
+// mixed into two 64-bit lanes, so hashing a table costs about one multiply per 8 bytes.
+// Feeding the same bytes in any split across update() calls gives the same hash.
+// Not a cryptographic hash; it only has to make accidental collisions negligible.
+class Hasher128 {
+private:
+    uint64_t h1;
+    uint64_t h2;
+    unsigned char tail[16];   // Bytes of an incomplete block
+    size_t tailLength;
+    uint64_t length;          // Total bytes fed
+
+    void mixBlock(const unsigned char* block);
+
+public:
+    explicit Hasher128(uint64_t seed = 0);
+    void update(const void* data, size_t size);
+    template <typename T>
+    void updateValue(const T& value) { update(&value, sizeof(value)); }
+    // Hash of everything fed so far; more can still be fed afterwards
+    Hash128 finish() const;
+};
+
+#endif // HASH128_H
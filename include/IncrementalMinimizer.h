@@ -0,0 +1,110 @@
+#ifndef INCREMENTAL_MINIMIZER_H
+#define INCREMENTAL_MINIMIZER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Automaton.h"
+#include "Partition.h"
+using namespace std;
+
+// Keeps a minimal complete DFA up to date under small edits.
+//
+// Edits are applied to the current minimal automaton and recorded as dirty states;
+// update() then restores minimality. Minimizing never splits states, so the only work
+// is finding states that became equivalent. A state whose language can have changed
+// must reach a dirty state; every other state keeps its language and stays distinct.
+// update() therefore refines only the affected states plus the unaffected states that
+// could be equivalent to one of them, with every other state standing in as a fixed
+// singleton block, and merges what comes out equal.
+//
+// State ids stay valid across updates: a merged state forwards to the state it was
+// merged into (see resolve()). States that become unreachable are kept until compact().
+class IncrementalMinimizer {
+private:
+    string symbols;                   // One column per symbol
+    array<int, 256> symbolToColumn;
+    size_t numColumns;
+    StateId numStates;                // Slots, including merged and removed ones
+    StateId startState;
+    StateId sinkState;                // Non-accepting self-loop state, NO_STATE if none yet or
+                                      // the last one was edited
+    vector<StateId> transitions;      // numStates x numColumns, row-major, always complete
+    vector<bool> accepting;
+    vector<StateId> forward;          // NO_STATE if live, the state merged into, or itself if removed
+    vector<StateId> dirty;            // States whose row or acceptance changed
+    vector<bool> isDirty;
+
+    // Predecessors: a CSR snapshot plus the edges added since, both checked against
+    // the current table on lookup so removed edges simply stop matching
+    StateId inverseStates;
+    vector<size_t> invOffsets;
+    vector<StateId> invSources;
+    unordered_map<uint64_t, vector<StateId>> addedEdges;   // (col, dest) -> sources
+    size_t addedEdgeCount;
+
+    // Per-state scratch for update(); an entry is current when its stamp equals epoch
+    vector<uint32_t> affectedStamp;
+    vector<uint32_t> localStamp;
+    vector<StateId> localId;
+    uint32_t epoch;
+    MinimizeScratch scratch;
+
+    bool isLive(StateId s) const { return forward[s] == NO_STATE; }
+    // Validate an edit argument and resolve it to a live state / a column
+    bool checkState(StateId& s, string& error) const;
+    bool checkSymbol(char symbol, size_t& column, string& error) const;
+    void markDirty(StateId s);
+    void writeTransition(StateId s, size_t column, StateId dest);
+    void rebuildInverse();
+    // Append the live states that go to dest on column (may contain duplicates)
+    void predecessors(StateId dest, size_t column, vector<StateId>& out) const;
+    // True if s is non-accepting and every transition loops back to it
+    bool isSinkRow(StateId s) const;
+    StateId ensureSink();
+    // Number the states reachable from the start (start = 0, others by id); returns the count
+    StateId numberReachable(vector<StateId>& newId) const;
+
+public:
+    // Minimizes a copy of dfa (unreachable states removed, alphabet expanded to one
+    // column per symbol) and starts tracking it
+    explicit IncrementalMinimizer(const Automaton& dfa);
+
+    // Edits. States are live ids (or ids that resolve() to one); symbols must be in the
+    // alphabet. On a bad argument the edit is not applied, false is returned and `error` set.
+    // Deleted edges go to a non-accepting self-looping sink; editing the sink's own row
+    // or acceptance makes it an ordinary state, and the next deletion creates a new sink.
+    // New state: non-accepting, every transition to the sink
+    StateId addState(bool isAccepting = false);
+    // Every transition into s goes to the sink instead and s is dropped
+    bool removeState(StateId s, string& error);
+    bool setTransition(StateId s, char symbol, StateId dest, string& error);
+    // Send the transition to the sink
+    bool removeTransition(StateId s, char symbol, string& error);
+    bool setAccepting(StateId s, bool isAccepting, string& error);
+
+    // Restore minimality after the edits made since the last call. Returns the number
+    // of states merged away.
+    size_t update();
+    // Drop merged and unreachable states and renumber the rest; returns old id -> new id
+    // (NO_STATE for dropped states). Costs a full pass over the table.
+    vector<StateId> compact();
+
+    // Follow merges to the live state that now stands for s (NO_STATE if it was removed)
+    StateId resolve(StateId s) const;
+    StateId getStartState() const { return startState; }
+    // Id slots, including merged and removed states
+    StateId getNumStates() const { return numStates; }
+    const string& getSymbols() const { return symbols; }
+    bool isAccepting(StateId s) const { return accepting[s]; }
+    StateId getTransition(StateId s, char symbol) const {
+        return transitions[(size_t)s * numColumns + symbolToColumn[(unsigned char)symbol]];
+    }
+    bool hasPendingEdits() const { return !dirty.empty(); }
+    // Copy of the reachable part as a minimized Automaton (Q0 = start, others by id order)
+    Automaton toAutomaton() const;
+};
+
+#endif // INCREMENTAL_MINIMIZER_H
@@ -0,0 +1,42 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Automaton.h"
+using namespace std;
+
+// State orders for the memory layout of the transition table. A step reads the row of
+// the next state, so numbering states that follow each other close together keeps
+// consecutive steps within the same cache lines and pages. Matcher and the generated
+// code keep this order within their non-accepting and accepting row ranges.
+enum class StateOrder {
+    // Breadth-first from the start state, successors in column order: states at the
+    // same depth share rows, which suits short matches from the start
+    BreadthFirst,
+    // Depth-first preorder from the start state: a state's first successor usually
+    // gets the next row, which suits long runs along the same symbols
+    DepthFirst,
+    // Most visited first on a sample trace (see profileStateVisits), ties and unvisited
+    // states in breadth-first order, so the hot states form one compact region
+    Profile
+};
+
+// Parse "bfs", "dfs" or "profile"
+bool parseStateOrder(const string& name, StateOrder& order);
+
+// Visits per state while running the DFA over a sample trace from the start state.
+// A byte outside the alphabet, an undefined transition or a dead state sends the run
+// back to the start state, as a scanner restarting after a rejection would.
+vector<uint64_t> profileStateVisits(const Automaton& dfa, const unsigned char* data, size_t length);
+
+// The states in `order`: entry i is the state to number i. Unreachable states come
+// last in their old order. `visits` is only read for StateOrder::Profile.
+vector<StateId> computeStateOrder(const Automaton& dfa, StateOrder order, const vector<uint64_t>& visits = {});
+
+// Renumber the DFA's states in `order` (see Automaton::permuteStates). The language and
+// the state names are unchanged.
+void reorderStates(Automaton& dfa, StateOrder order, const vector<uint64_t>& visits = {});
+
+#endif // LAYOUT_H
@@ -0,0 +1,96 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Automaton.h"
+#include "Nfa.h"
+using namespace std;
+
+// Buffered reader that splits a stream into whitespace-separated tokens.
+// Reads the stream in large blocks with fread instead of iostream extraction;
+// '#' starts a comment that runs to the end of the line.
+class Tokenizer {
+private:
+    FILE* file;
+    bool ownsFile;
+    vector<char> buffer;
+    size_t pos;
+    size_t len;
+    size_t line;
+
+    bool refill();
+    // Next character without consuming it, -1 at end of input
+    int peek() {
+        if (pos == len && !refill()) return -1;
+        return (unsigned char)buffer[pos];
+    }
+
+public:
+    // Wrap an already open stream (not closed by the tokenizer)
+    explicit Tokenizer(FILE* stream, size_t bufferSize = 1 << 20);
+    // Open a file by path; "-" means stdin. Check isOpen() afterwards.
+    explicit Tokenizer(const string& path, size_t bufferSize = 1 << 20);
+    ~Tokenizer();
+    Tokenizer(const Tokenizer&) = delete;
+    Tokenizer& operator=(const Tokenizer&) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+    size_t lineNumber() const { return line; }
+
+    // Skip whitespace and comments; returns false at end of input
+    bool skipSpace();
+    // Character that starts the next token, -1 at end of input
+    int peekToken() { return skipSpace() ? peek() : -1; }
+    bool readWord(string& word);
+    bool readUnsigned(uint64_t& value);
+    // Unsigned value or -1
+    bool readIndex(int64_t& value);
+    bool readChar(char& c);
+};
+
+// Text edge-list format, one automaton per record:
+//
+//   dfa <numStates> <alphabet>      header, must come first
+//   start <state>                   optional, defaults to 0
+//   accept <count> <state>...       optional
+//   dead <count> <state>...         optional
+//   <from> <symbols> <to>           one line per transition, <to> = -1 goes to the dead sink
+//   end                             optional at end of input, required between records
+//
+// <alphabet> and <symbols> are symbol sets: characters, \xHH escapes and bracket classes
+// with ranges, e.g. "ab", "[a-z0-9]" or "[\x00-\xFF]". A transition on a set applies to
+// every symbol in it. A single character always stands for itself.
+//
+// The transition table is allocated from the header; out-of-range indices and unknown
+// symbols are counted while parsing and reported together once the record is read.
+//
+// A record may instead describe an NFA:
+//
+//   nfa <numStates> <alphabet>      header
+//   start <state>                   optional and repeatable, each line adds a start state
+//   accept <count> <state>...       optional
+//   <from> <symbols> <to>           repeated (from, symbol) pairs add destinations
+//   eps <from> <to>                 epsilon move
+//   end
+//
+// There are no dead states and no -1 destinations; a missing move simply rejects.
+
+// Load the next record from the tokenizer, replacing the automaton's contents. An NFA
+// record is determinized (Nfa::determinize) into a partial DFA. On failure returns false
+// and sets `error`; the rest of the record is skipped, so loading can go on with the next
+// record.
+bool loadAutomaton(Tokenizer& in, Automaton& automaton, string& error);
+// Same, but an NFA record is loaded into `nfa` as is, with `isNfa` set, so the caller can
+// determinize it elsewhere (e.g. on a worker thread)
+bool loadRecord(Tokenizer& in, Automaton& automaton, Nfa& nfa, bool& isNfa, string& error);
+// Append a record for the automaton in the format above, one line per defined transition
+// and the symbols of each column as one symbol set
+void formatAutomaton(const Automaton& automaton, string& out);
+
+// Load a single automaton from a file path ("-" for stdin)
+bool loadAutomatonFile(const string& path, Automaton& automaton, string& error);
+
+#endif // LOADER_H
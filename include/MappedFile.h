@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+using namespace std;
+
+// Read-only memory mapping of a whole file (mmap on POSIX, MapViewOfFile on Windows)
+class MappedFile {
+private:
+    const unsigned char* data;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map the file at path; on failure returns false and sets `error`
+    bool open(const string& path, string& error);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    const unsigned char* bytes() const { return data; }
+    size_t size() const { return length; }
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,83 @@
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Automaton.h"
+using namespace std;
+
+// Position of the scan in a stream that arrives in several buffers
+struct ScanState {
+    uint32_t state;       // Current matcher state (a row offset)
+    uint64_t offset;      // Bytes consumed so far
+    uint64_t lineStart;   // Offset of the first byte of the current line
+};
+
+// Execution engine compiled from a DFA (normally the output of minimizeDFA).
+// Bytes are mapped to columns through a 256-entry class table, states are stored as
+// pre-multiplied row offsets so a step is a single load, and rows are ordered
+// [reject sink, non-accepting states, accepting states] so that acceptance is one
+// comparison. Bytes outside the alphabet and undefined transitions go to the sink, and
+// so do non-accepting states that only loop to themselves, so a scan can stop early.
+class Matcher {
+private:
+    array<uint32_t, 256> byteClass;   // Byte -> column
+    uint32_t stride;                  // Columns per row (symbol classes + 1)
+    vector<uint32_t> table;           // Row offset + column -> next row offset
+    uint32_t startState;
+    uint32_t acceptBoundary;          // Row offsets >= this are accepting
+    uint32_t numStates;               // Rows, including the reject sink
+
+    // Shared by the parallel runs; positions is null when only the final state is wanted
+    uint32_t runParallel(uint32_t state, const unsigned char* data, size_t length, uint64_t base,
+                         vector<uint64_t>* positions, unsigned numThreads) const;
+
+public:
+    // An empty matcher: a lone reject sink, so every input is rejected
+    Matcher();
+    // Compile `dfa` into `matcher`. Row offsets are 32-bit, so a DFA whose table would
+    // not fit is refused: returns false and sets `error`, leaving `matcher` unchanged.
+    static bool compile(const Automaton& dfa, Matcher& matcher, string& error);
+
+    uint32_t start() const { return startState; }
+    static uint32_t rejectState() { return 0; }
+    bool isAccepting(uint32_t state) const { return state >= acceptBoundary; }
+    uint32_t getNumStates() const { return numStates; }
+    uint32_t step(uint32_t state, unsigned char byte) const { return table[state + byteClass[byte]]; }
+
+    // Run over a buffer from `state` and return the state reached
+    uint32_t feed(uint32_t state, const unsigned char* data, size_t length) const;
+    // True if the whole buffer is accepted
+    bool matches(const unsigned char* data, size_t length) const;
+    // Run from `state`, appending base + i + 1 for every byte i after which the automaton
+    // accepts (i.e. the end offsets of accepted prefixes). Returns the state reached.
+    uint32_t findAccepts(uint32_t state, const unsigned char* data, size_t length,
+                         uint64_t base, vector<uint64_t>& positions) const;
+
+    // Data-parallel versions of the three above for one large buffer, on numThreads
+    // threads (0 = all cores); the results are exactly those of the sequential runs.
+    // The buffer is split into one chunk per thread. Every chunk but the first runs
+    // speculatively from all states at once, and lanes that reach the same state merge,
+    // so a chunk soon costs about as much as a plain run. The chunks are then stitched
+    // in order, each mapping the state the previous one ended in.
+    uint32_t feedParallel(uint32_t state, const unsigned char* data, size_t length, unsigned numThreads = 0) const;
+    bool matchesParallel(const unsigned char* data, size_t length, unsigned numThreads = 0) const;
+    uint32_t findAcceptsParallel(uint32_t state, const unsigned char* data, size_t length, uint64_t base,
+                                 vector<uint64_t>& positions, unsigned numThreads = 0) const;
+
+    // Line mode: every '\n'-terminated line is run from the start state on its own and
+    // the starting offset of each line accepted in full is appended to `lines`.
+    ScanState beginLines() const;
+    void scanLines(ScanState& scan, const unsigned char* data, size_t length,
+                   vector<uint64_t>& lines) const;
+    // Finish the last line if the input did not end with '\n'
+    void finishLines(ScanState& scan, vector<uint64_t>& lines) const;
+
+    // Scan a file in line mode ("-" reads stdin in blocks, other paths are memory-mapped).
+    // On failure returns false and sets `error`.
+    bool scanFileLines(const string& path, vector<uint64_t>& lines, string& error) const;
+};
+
+#endif // MATCHER_H
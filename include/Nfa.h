@@ -0,0 +1,90 @@
+#ifndef NFA_H
+#define NFA_H
+
+#include <array>
+#include <bitset>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Automaton.h"
+using namespace std;
+
+// Nondeterministic finite automaton with epsilon moves, built by the loader (see Loader.h)
+// and turned into a DFA by determinize().
+//
+// Transitions are added on symbol sets. finishMoves() splits the alphabet into the
+// coarsest classes that no set distinguishes, so a rule on "[a-z]" costs one move per
+// class it covers rather than one per symbol, and the DFA gets one column per class.
+class Nfa {
+public:
+    // Column of epsilon moves; they sort after every symbol class
+    static const uint32_t EPSILON = numeric_limits<uint32_t>::max();
+
+    struct Move {
+        uint32_t column;
+        StateId target;
+    };
+
+private:
+    struct Edge {
+        StateId from;
+        uint32_t symbolSet;   // Index into symbolSets, EPSILON for an epsilon move
+        StateId to;
+    };
+
+    vector<char> alphabet;                  // Symbols (sorted)
+    array<int, 256> symbolToColumn;         // Byte -> class, -1 outside the alphabet
+    size_t numColumns;
+    StateId numStates;
+    vector<StateId> startStates;
+    vector<bool> acceptingStates;
+
+    // Added transitions, before finishMoves(); symbol sets are interned
+    vector<Edge> edges;
+    vector<bitset<256>> symbolSets;
+    unordered_map<bitset<256>, uint32_t> symbolSetIds;
+
+    // Moves of state s are moves[moveOffsets[s] .. moveOffsets[s + 1]), sorted by column
+    // and target without duplicates, so the epsilon moves come last
+    vector<Move> moves;
+    vector<size_t> moveOffsets;
+
+public:
+    Nfa();
+
+    // Replace the contents with `count` states over `symbols`, without moves
+    void reset(const string& symbols, StateId count);
+    void addStartState(StateId s) { startStates.push_back(s); }
+    void setAccepting(StateId s, bool accepting) { acceptingStates[s] = accepting; }
+    // `symbols` holds 256 flags, all inside the alphabet
+    void addTransition(StateId from, const vector<bool>& symbols, StateId to);
+    void addEpsilon(StateId from, StateId to) { edges.push_back(Edge{from, EPSILON, to}); }
+    // Compute the symbol classes and the per-state move lists from the added transitions
+    void finishMoves();
+
+    StateId getNumStates() const { return numStates; }
+    size_t getNumColumns() const { return numColumns; }
+    const vector<char>& getAlphabet() const { return alphabet; }
+    int getColumn(char symbol) const { return symbolToColumn[(unsigned char)symbol]; }
+    // Defaults to state 0 if no start state was added
+    const vector<StateId>& getStartStates() const { return startStates; }
+    bool isAccepting(StateId s) const { return acceptingStates[s]; }
+    const Move* movesBegin(StateId s) const { return moves.data() + moveOffsets[s]; }
+    const Move* movesEnd(StateId s) const { return moves.data() + moveOffsets[s + 1]; }
+    size_t getNumMoves() const { return moves.size(); }
+
+    // Subset construction over the reachable state sets, into a partial DFA: the empty
+    // set is not materialized, so symbols without a move leave the transition undefined.
+    //
+    // Each DFA state is a sorted vector of NFA states stored once in a shared pool and
+    // found again through a hash table of the sets (hash-consing), so no set is ever
+    // named or copied as a string. Epsilon closures are computed once per NFA state and
+    // cached. The successors of a set are collected in one pass over the moves of its
+    // members, bucketed by column, so the work per set is proportional to its moves
+    // rather than to |set| x columns.
+    //
+    // Returns false and sets `error` if more than maxStates DFA states would be needed.
+    bool determinize(Automaton& dfa, string& error, StateId maxStates = NO_STATE - 1) const;
+};
+
+#endif // NFA_H
@@ -0,0 +1,79 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "Automaton.h"
+using namespace std;
+
+// Refinable partition of the states 0..n-1.
+// The elements of every block are stored contiguously in `elements`; marking a state
+// moves it to the front of its block so that a split only touches the marked part.
+class Partition {
+private:
+    vector<StateId> elements;     // States grouped by block
+    vector<size_t> position;      // State -> index in elements
+    vector<BlockId> blockOfState; // State -> block
+    vector<size_t> blockStart;    // Block -> first index in elements
+    vector<size_t> blockEnd;      // Block -> one past the last index
+    vector<size_t> blockMid;      // Block -> one past the last marked element
+    vector<BlockId> touched;      // Blocks with at least one marked element
+
+public:
+    Partition() {}
+    explicit Partition(StateId n) { reset(n); }
+
+    // Put all n states into a single block (no blocks if n == 0)
+    void reset(StateId n);
+    // Put state s into block initial[s]; empty blocks are dropped and the remaining ones
+    // renumbered in order
+    void reset(const vector<BlockId>& initial, size_t numBlocks);
+
+    size_t blockCount() const { return blockStart.size(); }
+    BlockId blockOf(StateId s) const { return blockOfState[s]; }
+    const vector<BlockId>& blockIds() const { return blockOfState; }
+    size_t blockSize(BlockId b) const { return blockEnd[b] - blockStart[b]; }
+    const StateId* begin(BlockId b) const { return elements.data() + blockStart[b]; }
+    const StateId* end(BlockId b) const { return elements.data() + blockEnd[b]; }
+    // Any member of the block, used as its representative
+    StateId first(BlockId b) const { return elements[blockStart[b]]; }
+    // Bytes reserved by the partition's arrays
+    uint64_t memoryBytes() const;
+
+    // Mark a state for the next split; marking twice is a no-op
+    void mark(StateId s);
+    // Split every block that has both marked and unmarked states. The marked states
+    // move to a new block, or with smallerIsNew whichever part is smaller does.
+    // Appends (original block, new block) pairs to `splits` and clears all marks.
+    void splitMarked(vector<pair<BlockId, BlockId>>& splits, bool smallerIsNew = false);
+};
+
+// Buffers for one minimization. A caller that minimizes many automata keeps one of
+// these and passes it to every call so the allocations are reused.
+struct MinimizeScratch {
+    vector<size_t> invOffsets;
+    vector<StateId> invSources;
+    Partition partition;
+    vector<pair<BlockId, size_t>> worklist;
+    vector<bool> inWorklist;
+    vector<StateId> predecessors;
+    vector<pair<BlockId, BlockId>> splits;
+    vector<StateId> blockMap;      // Block -> quotient state
+    Automaton quotient;            // minimizeInPlace builds here, then swaps
+};
+
+// Predecessor lists of every (column, destination) pair of a row-major numStates x
+// numColumns table in CSR form: sources[offsets[col * numStates + d] ..
+// offsets[col * numStates + d + 1]) go to d on col, in increasing order. NO_STATE
+// entries are skipped.
+void buildInverseTransitions(const vector<StateId>& transitions, StateId numStates, size_t numColumns,
+                             vector<size_t>& offsets, vector<StateId>& sources);
+
+// Hopcroft's refinement: split scratch.partition until every block is stable under every
+// (block, column) splitter, using the inverse in scratch.invOffsets / invSources. The
+// partition may start with any number of blocks; the largest is left out of the
+// initial worklist.
+void refinePartition(MinimizeScratch& scratch, size_t numColumns);
+
+#endif // PARTITION_H
@@ -0,0 +1,41 @@
+#ifndef PRODUCT_H
+#define PRODUCT_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include "Automaton.h"
+using namespace std;
+
+// Columns of a pair of automata over the union of their alphabets: symbols that share
+// a column in both automata form one joint class
+struct JointClasses {
+    vector<int> firstColumn;          // Class -> column in the first automaton, -1 if absent
+    vector<int> secondColumn;         // Class -> column in the second automaton, -1 if absent
+    vector<char> symbol;              // Class -> one of its symbols
+    array<int, 256> classOfSymbol;    // Byte -> class, -1 outside both alphabets
+};
+
+void computeJointClasses(const Automaton& first, const Automaton& second, JointClasses& classes);
+
+enum class ProductOperation {
+    Intersection,   // Accepted by both
+    Union,          // Accepted by either
+    Difference      // Accepted by the first but not the second
+};
+
+// Build the product of two DFAs under a boolean operation, exploring only the state
+// pairs reachable from the pair of start states.
+//
+// Pairs are numbered through a hashed pair -> id table as they are discovered. A pair
+// is not created when the per-automaton liveness of its components already rules out
+// acceptance (e.g. for an intersection, one side can no longer accept), and after the
+// search every pair that cannot reach an accepting pair is dropped. The result is a
+// partial DFA without those pairs, ready for minimizePartialDFA(). Undefined
+// transitions and symbols outside an alphabet go to an implicit rejecting sink.
+//
+// Returns false and sets `error` if the product has too many states for a StateId.
+bool buildProduct(const Automaton& first, const Automaton& second, ProductOperation op,
+                  Automaton& result, string& error);
+
+#endif // PRODUCT_H
@@ -0,0 +1,58 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Automaton.h"
+#include "Hash128.h"
+using namespace std;
+
+// 128-bit hash of the automaton exactly as stored: state and column counts, symbol
+// classes, start state, accepting states and the transition table (names and dead
+// marks are left out). On a canonical automaton (see Automaton::canonicalize) this is
+// a hash of its language's structure.
+Hash128 hashAutomaton(const Automaton& automaton, uint64_t seed = 0);
+
+// Minimization results keyed by the hash of the input automaton and the kind of
+// minimization, so an unchanged input is answered without minimizing it again.
+// Results are stored in canonical form: in memory, up to memoryLimit bytes of
+// transition tables (the oldest entries are dropped first), and, if a directory is
+// given, as binary files named <key>.bin that later runs pick up. All methods are
+// thread-safe.
+class ResultCache {
+private:
+    string directory;
+    size_t memoryLimit;
+    mutable mutex lock;
+    unordered_map<Hash128, Automaton, Hash128Hasher> entries;
+    deque<Hash128> insertionOrder;
+    size_t memoryUsed;
+    atomic<uint64_t> hits;
+    atomic<uint64_t> misses;
+
+    string pathOf(const Hash128& key) const;
+    void remember(const Hash128& key, const Automaton& result);
+
+public:
+    explicit ResultCache(const string& directory = "", size_t memoryLimit = (size_t)1 << 30);
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Key of an input: its hash, seeded by the minimization kind (complete or partial)
+    static Hash128 key(const Automaton& input, bool partial);
+    // Copy the stored result into `result`; checks memory first, then the directory
+    bool find(const Hash128& key, Automaton& result);
+    // Store a canonical result. The file is written under a temporary name and renamed,
+    // so concurrent runs sharing the directory never see a partial file. Returns false
+    // and sets `error` if the file cannot be written (the memory entry is kept).
+    bool insert(const Hash128& key, const Automaton& result, string& error);
+
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+};
+
+#endif // RESULT_CACHE_H
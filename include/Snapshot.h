@@ -0,0 +1,136 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Automaton.h"
+#include "Matcher.h"
+using namespace std;
+
+// One immutable version of a DFA, compiled for matching. Everything is built by build()
+// and only const methods follow, so any number of threads can read it without
+// synchronization for as long as it is alive.
+class DfaSnapshot {
+private:
+    Matcher matcher;
+    uint64_t version;
+    StateId sourceStates;        // States of the DFA it was built from
+    size_t sourceColumns;
+
+    DfaSnapshot(const Automaton& dfa, uint64_t version);
+
+public:
+    // Build from a DFA, normally the output of minimizeDFA(). `version` is the
+    // caller's label for this rule set (e.g. a reload counter). Returns false and sets
+    // `error` if the DFA cannot be compiled (see Matcher::compile).
+    static bool build(const Automaton& dfa, uint64_t version, unique_ptr<const DfaSnapshot>& snapshot,
+                      string& error);
+    DfaSnapshot(const DfaSnapshot&) = delete;
+    DfaSnapshot& operator=(const DfaSnapshot&) = delete;
+
+    const Matcher& getMatcher() const { return matcher; }
+    uint64_t getVersion() const { return version; }
+    StateId getSourceStates() const { return sourceStates; }
+    size_t getSourceColumns() const { return sourceColumns; }
+    bool matches(const unsigned char* data, size_t length) const { return matcher.matches(data, length); }
+};
+
+class SnapshotReader;
+
+// Publishes the current DfaSnapshot to concurrent readers with RCU-style epochs.
+//
+// Readers never block: pinning a snapshot is one store to the reader's own slot and
+// two atomic loads, and the writer never waits for readers either. publish() swaps
+// the current pointer, advances the global epoch and retires the old snapshot tagged
+// with the new epoch. A retired snapshot is freed once every reader slot is idle or
+// was pinned at that epoch or later: such a reader read the epoch after the swap, so
+// it can only hold a newer snapshot. Snapshots still in use are freed by a later
+// publish() or reclaim().
+//
+// Writers are serialized by a mutex that readers never touch. Readers must be
+// destroyed before the publisher.
+class SnapshotPublisher {
+private:
+    friend class SnapshotReader;
+
+    // One per reader, on its own cache line so that pins do not contend.
+    // `pinned` holds the epoch the reader pinned at, or 0 while it holds nothing.
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> pinned;
+        atomic<bool> claimed;
+        ReaderSlot* next;
+    };
+
+    struct Retired {
+        const DfaSnapshot* snapshot;
+        uint64_t epoch;          // Epoch at which it stopped being current
+    };
+
+    atomic<const DfaSnapshot*> current;
+    atomic<uint64_t> epoch;
+    atomic<ReaderSlot*> slots;   // Lock-free list; slots are reused, never unlinked
+    mutex writerLock;
+    vector<Retired> retired;
+    uint64_t reclaimedCount;
+
+    ReaderSlot* claimSlot();
+    size_t reclaimLocked();
+
+public:
+    // Starts with `initial` as the current snapshot (none if null)
+    explicit SnapshotPublisher(unique_ptr<const DfaSnapshot> initial = nullptr);
+    ~SnapshotPublisher();
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Make `next` the snapshot that new pins see and retire the previous one. Build the
+    // snapshot before calling, so the writer lock is only held for the swap. Returns
+    // the number of retired snapshots still waiting for readers.
+    size_t publish(unique_ptr<const DfaSnapshot> next);
+    // Free every retired snapshot no reader can still hold; returns how many remain
+    size_t reclaim();
+
+    // For monitoring only: readers must pin to use the snapshot
+    uint64_t getEpoch() const { return epoch.load(); }
+    uint64_t getReclaimed();
+};
+
+// A reader's handle on a publisher: one per thread, cheap to pin and release. A reader
+// holds at most one snapshot at a time, which stays valid until release().
+class SnapshotReader {
+private:
+    SnapshotPublisher& publisher;
+    SnapshotPublisher::ReaderSlot* slot;
+
+public:
+    explicit SnapshotReader(SnapshotPublisher& publisher);
+    ~SnapshotReader();
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    // Pin and return the current snapshot (null if none was published yet)
+    const DfaSnapshot* acquire();
+    void release();
+};
+
+// Scoped acquire()/release()
+class PinnedSnapshot {
+private:
+    SnapshotReader& reader;
+    const DfaSnapshot* snapshot;
+
+public:
+    explicit PinnedSnapshot(SnapshotReader& reader) : reader(reader), snapshot(reader.acquire()) {}
+    ~PinnedSnapshot() { reader.release(); }
+    PinnedSnapshot(const PinnedSnapshot&) = delete;
+    PinnedSnapshot& operator=(const PinnedSnapshot&) = delete;
+
+    const DfaSnapshot* get() const { return snapshot; }
+    const DfaSnapshot* operator->() const { return snapshot; }
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,134 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Instrumentation probes (phase timers, counters, structure sizes). Build with
+// -DDFA_STATS=0 (make STATS=0) to compile every probe out of the library.
+#ifndef DFA_STATS
+#define DFA_STATS 1
+#endif
+
+// Statistics of one run: wall and CPU time per named phase, event counters and the
+// largest size seen for each data structure. Phases may nest, in which case the
+// outer phase includes the time of the inner one.
+class StatsReport {
+private:
+    struct Phase {
+        string name;
+        uint64_t calls;
+        double wallSeconds;
+        double cpuSeconds;     // Process CPU time, so it covers worker threads too
+    };
+    struct Value {
+        string name;
+        uint64_t value;
+    };
+    vector<Phase> phases;      // In order of first use
+    vector<Value> counters;    // Summed
+    vector<Value> peaks;       // Maximum seen
+    vector<Value> bytes;       // Maximum seen, per structure
+
+    static Value& find(vector<Value>& values, const char* name);
+
+public:
+    void addPhase(const char* name, double wallSeconds, double cpuSeconds, uint64_t calls = 1);
+    void add(const char* name, uint64_t value);
+    void peak(const char* name, uint64_t value);
+    void addBytes(const char* name, uint64_t size);
+    // Fold in a report collected on another thread
+    void merge(const StatsReport& other);
+
+    // Append the report as a JSON object (with the process peak RSS) to `out`
+    void writeJson(string& out) const;
+};
+
+// Report that the probes on the calling thread write to, nullptr when not collecting
+StatsReport* currentStats();
+
+// Makes `report` the calling thread's current report until the scope ends
+class StatsScope {
+private:
+    StatsReport* previous;
+
+public:
+    explicit StatsScope(StatsReport* report);
+    ~StatsScope();
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+};
+
+// Times the enclosing scope as one call of a phase of the current report
+class PhaseTimer {
+private:
+    StatsReport* report;
+    const char* name;
+    chrono::steady_clock::time_point wallStart;
+    clock_t cpuStart;
+
+public:
+    explicit PhaseTimer(const char* name);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+// Process-wide high-water mark of resident memory in KiB (0 if unavailable)
+long peakRssKb();
+
+// Hardware count of cache misses (references that missed the last-level cache) in the
+// calling thread, from Linux perf events. Unavailable on other platforms, in virtual
+// machines without a PMU, or when perf_event_paranoid forbids it.
+class CacheMissCounter {
+private:
+    int fd;
+
+public:
+    CacheMissCounter();
+    ~CacheMissCounter();
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool isAvailable() const { return fd >= 0; }
+    void start();
+    // Misses since start(), or -1 if the counter is unavailable
+    long long stop();
+};
+
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+
+#if DFA_STATS
+#define STATS_PHASE(name) PhaseTimer STATS_CONCAT(statsPhase, __LINE__)(name)
+#define STATS_ADD(name, value) \
+    do { if (StatsReport* statsReport_ = currentStats()) statsReport_->add(name, value); } while (0)
+#define STATS_PEAK(name, value) \
+    do { if (StatsReport* statsReport_ = currentStats()) statsReport_->peak(name, value); } while (0)
+#define STATS_BYTES(name, size) \
+    do { if (StatsReport* statsReport_ = currentStats()) statsReport_->addBytes(name, size); } while (0)
+// Code that only exists to feed the probes, e.g. a local counter in a hot loop
+#define STATS_ONLY(code) code
+#else
+#define STATS_PHASE(name) do {} while (0)
+#define STATS_ADD(name, value) do {} while (0)
+#define STATS_PEAK(name, value) do {} while (0)
+#define STATS_BYTES(name, size) do {} while (0)
+#define STATS_ONLY(code)
+#endif
+
+// Bytes reserved by a vector
+template <typename T>
+uint64_t vectorBytes(const vector<T>& v) {
+    return (uint64_t)v.capacity() * sizeof(T);
+}
+
+inline uint64_t vectorBytes(const vector<bool>& v) {
+    return (uint64_t)v.capacity() / 8;
+}
+
+#endif // STATS_H
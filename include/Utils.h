@@ -3,11 +3,81 @@
 
 #include <string>
 #include <set>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <algorithm>
 
 // Utility functions for automaton operations
 namespace utils {
     // Convert a set of states to a state name
     std::string setToStateName(const std::set<std::string>& stateSet);
+
+    // Printable form of one symbol: the character itself, or \xHH for control,
+    // space, non-ASCII and bracket characters
+    std::string symbolLabel(char symbol);
+    // Label for a class of symbols: "a" for one symbol, "[a-cx]" for several
+    std::string symbolClassLabel(const std::vector<char>& symbols);
+
+    // Chunk t of the split of [0, count) into numThreads chunks
+    inline void chunkRange(size_t count, unsigned numThreads, unsigned t, size_t& begin, size_t& end) {
+        size_t chunk = (count + numThreads - 1) / numThreads;
+        begin = std::min(count, t * chunk);
+        end = std::min(count, begin + chunk);
+    }
+
+    // Split [0, count) into numThreads contiguous chunks and call fn(begin, end, threadIndex)
+    // for every chunk, each on its own thread. Chunk t always goes to threadIndex t, so
+    // per-thread results can be combined in a deterministic order.
+    template <typename Fn>
+    void parallelFor(unsigned numThreads, size_t count, Fn fn) {
+        if (numThreads <= 1) {
+            fn((size_t)0, count, 0u);
+            return;
+        }
+        std::vector<std::thread> workers;
+        workers.reserve(numThreads - 1);
+        size_t begin, end;
+        for (unsigned t = 1; t < numThreads; ++t) {
+            chunkRange(count, numThreads, t, begin, end);
+            workers.emplace_back(fn, begin, end, t);
+        }
+        chunkRange(count, numThreads, 0, begin, end);
+        fn(begin, end, 0u);
+        for (auto& worker : workers) worker.join();
+    }
+
+    // Reusable barrier for a fixed set of threads that work through several phases.
+    // The last thread to arrive runs `completion` before any thread is released, so a
+    // serial step between two parallel phases needs no extra synchronization.
+    class Barrier {
+    private:
+        std::mutex lock;
+        std::condition_variable released;
+        unsigned numThreads;
+        unsigned waiting;
+        unsigned long long generation;
+
+    public:
+        explicit Barrier(unsigned numThreads) : numThreads(numThreads), waiting(0), generation(0) {}
+
+        template <typename Fn>
+        void arriveAndWait(Fn completion) {
+            std::unique_lock<std::mutex> guard(lock);
+            if (++waiting == numThreads) {
+                completion();
+                waiting = 0;
+                ++generation;
+                released.notify_all();
+                return;
+            }
+            unsigned long long arrived = generation;
+            released.wait(guard, [&] { return generation != arrived; });
+        }
+        void arriveAndWait() { arriveAndWait([] {}); }
+    };
 }
 
-#endif // UTILS_H
\ No newline at end of file
+#endif // UTILS_H
@@ -1,9 +1,86 @@
 #include "Automaton.h"
+#include "Export.h"
 #include "Utils.h"
+#include "Partition.h"
+#include "Stats.h"
+#include <atomic>
+#include <memory>
+#include <thread>
 
 using namespace std;
 
-Automaton::Automaton() : numStates(0), startState("q0"), isDFA(true) {}
+Automaton::Automaton() : numColumns(0), numStates(0), startState(0), isDFA(true), verbose(true), reachableCount(0), reachabilityValid(false) {
+    symbolToColumn.fill(-1);
+}
+
+StateId Automaton::addState(const string& name) {
+    stateNames.push_back(name);
+    acceptingStates.push_back(false);
+    deadStates.push_back(false);
+    transitions.resize(transitions.size() + numColumns, NO_STATE);
+    reachabilityValid = false;
+    return numStates++;
+}
+
+StateId Automaton::findState(const string& name) const {
+    for (StateId s = 0; s < numStates; ++s) {
+        if (stateNames[s] == name) return s;
+    }
+    return NO_STATE;
+}
+
+void Automaton::setAlphabet(const string& symbols) {
+    set<char> unique(symbols.begin(), symbols.end());
+    alphabet.assign(unique.begin(), unique.end());
+    symbolToColumn.fill(-1);
+    for (size_t col = 0; col < alphabet.size(); ++col) {
+        symbolToColumn[(unsigned char)alphabet[col]] = (int)col;
+    }
+    numColumns = alphabet.size();
+}
+
+void Automaton::setAlphabetClasses(const array<int, 256>& columnOfSymbol) {
+    alphabet.clear();
+    numColumns = 0;
+    symbolToColumn = columnOfSymbol;
+    for (int c = 0; c < 256; ++c) {
+        if (symbolToColumn[c] < 0) continue;
+        alphabet.push_back((char)c);
+        numColumns = max(numColumns, (size_t)symbolToColumn[c] + 1);
+    }
+    sort(alphabet.begin(), alphabet.end());
+}
+
+vector<char> Automaton::getColumnSymbols(size_t column) const {
+    vector<char> symbols;
+    for (char symbol : alphabet) {
+        if (symbolToColumn[(unsigned char)symbol] == (int)column) symbols.push_back(symbol);
+    }
+    return symbols;
+}
+
+void Automaton::initStates(StateId count) {
+    numStates = count;
+    startState = 0;
+    stateNames.clear();
+    stateNames.reserve(count);
+    for (StateId i = 0; i < count; ++i) {
+        stateNames.push_back("q" + to_string(i));
+    }
+    acceptingStates.assign(count, false);
+    deadStates.assign(count, false);
+    transitions.assign((size_t)count * numColumns, NO_STATE);
+    reachabilityValid = false;
+}
+
+StateId Automaton::ensureDeadState() {
+    StateId deadState = findState("qd");
+    if (deadState == NO_STATE) {
+        deadState = addState("qd");
+        deadStates[deadState] = true;
+    }
+    return deadState;
+}
 
 // Input alphabet from user
 void Automaton::inputAlphabet() {
@@ -12,10 +89,7 @@ void Automaton::inputAlphabet() {
     string symbols;
     cin >> symbols;
 
-    alphabet.clear();
-    for (char c : symbols) {
-        alphabet.insert(c);
-    }
+    setAlphabet(symbols);
 
     cout << "Alphabet: {";
     for (auto it = alphabet.begin(); it != alphabet.end(); ++it) {
@@ -28,9 +102,10 @@ void Automaton::inputAlphabet() {
 // Generate states based on user input
 void Automaton::generateStates() {
     cout << "\nStep 2: Define States\n";
+    int count;
     while (true) {
         cout << "Enter number of states (minimum 1): ";
-        if (!(cin >> numStates) || numStates < 1) {
+        if (!(cin >> count) || count < 1) {
             cout << "Invalid input. Please enter a positive number.\n";
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -40,15 +115,12 @@ void Automaton::generateStates() {
     }
     
 
-    states.clear();
-    for (int i = 0; i < numStates; ++i) {
-        states.push_back("q" + to_string(i));
-    }
+    initStates(count);
 
     cout << "States: {";
-    for (size_t i = 0; i < states.size(); ++i) {
-        cout << states[i];
-        if (i < states.size() - 1) cout << ",";
+    for (StateId i = 0; i < numStates; ++i) {
+        cout << stateNames[i];
+        if (i < numStates - 1) cout << ",";
     }
     cout << "}\n";
     cout << "Initial state is: q0\n";
@@ -64,20 +136,20 @@ void Automaton::inputDeadStates() {
         for (int i = 0; i < numDead; ++i) {
             int idx;
             cin >> idx;
-            if (idx < 0 || idx >= numStates) {
+            if (idx < 0 || idx >= (int)numStates) {
                 cerr << "Invalid state index: " << idx << endl;
                 exit(1);
             }
-            deadStates.insert(states[idx]);
+            deadStates[idx] = true;
         }
     }
 
     cout << "Dead states: ";
-    if (deadStates.empty()) {
+    if (find(deadStates.begin(), deadStates.end(), true) == deadStates.end()) {
         cout << "None";
     } else {
-        for (const auto& state : deadStates) {
-            cout << state << " ";
+        for (StateId s = 0; s < numStates; ++s) {
+            if (deadStates[s]) cout << stateNames[s] << " ";
         }
     }
     cout << endl;
@@ -88,7 +160,7 @@ void Automaton::inputAcceptingStates() {
     int num;
     while (true) {
         cout << "Enter number of accepting states (0-" << numStates << "): ";
-        if (!(cin >> num) || num < 0 || num > numStates) {
+        if (!(cin >> num) || num < 0 || num > (int)numStates) {
             cout << "Invalid input. Please enter a number between 0 and " << numStates << ".\n";
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -97,9 +169,10 @@ void Automaton::inputAcceptingStates() {
         break;
     }
 
-    acceptingStates.clear();
+    acceptingStates.assign(numStates, false);
+    int accepted = 0;
     cout << "Enter state indices (0-" << numStates-1 << ") one per line:\n";
-    while (acceptingStates.size() < (unsigned)num) {
+    while (accepted < num) {
         int idx;
         if (!(cin >> idx)) {
             cout << "Invalid input. Please enter a number.\n";
@@ -107,21 +180,25 @@ void Automaton::inputAcceptingStates() {
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             continue;
         }
-        if (idx < 0 || idx >= numStates) {
+        if (idx < 0 || idx >= (int)numStates) {
             cout << "Invalid index. Please enter a number between 0 and " << numStates-1 << ": ";
             continue;
         }
-        if (acceptingStates.find(states[idx]) != acceptingStates.end()) {
-            cout << "State " << states[idx] << " is already an accepting state. Enter a different state.\n";
+        if (acceptingStates[idx]) {
+            cout << "State " << stateNames[idx] << " is already an accepting state. Enter a different state.\n";
             continue;
         }
-        acceptingStates.insert(states[idx]);
+        acceptingStates[idx] = true;
+        ++accepted;
     }
 
     cout << "Accepting states: {";
-    for (auto it = acceptingStates.begin(); it != acceptingStates.end(); ++it) {
-        cout << *it;
-        if (next(it) != acceptingStates.end()) cout << ",";
+    bool first = true;
+    for (StateId s = 0; s < numStates; ++s) {
+        if (!acceptingStates[s]) continue;
+        if (!first) cout << ",";
+        cout << stateNames[s];
+        first = false;
     }
     cout << "}\n";
 }
@@ -131,11 +208,14 @@ void Automaton::inputTransitions() {
     cout << "For each state and symbol, enter the destination state index.\n";
     cout << "Enter -1 for transitions to a dead state.\n\n";
 
-    for (const auto& state : states) {
-        cout << "Transitions from state " << state << ":\n";
-        for (char symbol : alphabet) {
+    // The sink may be appended while reading, so only walk the user-defined states
+    const StateId definedStates = numStates;
+    for (StateId state = 0; state < definedStates; ++state) {
+        cout << "Transitions from state " << stateNames[state] << ":\n";
+        for (size_t col = 0; col < numColumns; ++col) {
+            string symbol = utils::symbolClassLabel(getColumnSymbols(col));
             while (true) {
-                cout << "  On symbol '" << symbol << "' goes to (enter 0-" << numStates-1 << " or -1): ";
+                cout << "  On symbol '" << symbol << "' goes to (enter 0-" << definedStates-1 << " or -1): ";
                 int destIndex;
                 if (!(cin >> destIndex)) {
                     cout << "Invalid input. Please enter a number.\n";
@@ -143,24 +223,16 @@ void Automaton::inputTransitions() {
                     cin.ignore(numeric_limits<streamsize>::max(), '\n');
                     continue;
                 }
-                if (destIndex != -1 && (destIndex < 0 || destIndex >= numStates)) {
-                    cout << "Invalid index. Please enter -1 or a number between 0 and " << numStates-1 << ".\n";
+                if (destIndex != -1 && (destIndex < 0 || destIndex >= (int)definedStates)) {
+                    cout << "Invalid index. Please enter -1 or a number between 0 and " << definedStates-1 << ".\n";
                     continue;
                 }
 
                 if (destIndex == -1) {
-                    string deadState = "qd";
-                    if (find(states.begin(), states.end(), deadState) == states.end()) {
-                        states.push_back(deadState);
-                        numStates++;
-                        deadStates.insert(deadState);
-                    }
-                    transitions[state][symbol].clear();
-                    transitions[state][symbol].insert(deadState);
+                    setTransition(state, col, ensureDeadState());
                     break;
                 } else {
-                    transitions[state][symbol].clear();
-                    transitions[state][symbol].insert(states[destIndex]);
+                    setTransition(state, col, (StateId)destIndex);
                     break;
                 }
             }
@@ -170,65 +242,8 @@ void Automaton::inputTransitions() {
 }
 
 void Automaton::displayTransitionTable(const string& title) {
-    // Constants for column widths
-    const int ARROW_WIDTH = 4;
-    const int STATE_WIDTH = 10;
-    const int TRANS_WIDTH = 10;
-
-    // Title and header
-    cout << "\n" << title << "\n";
-    cout << "================ Transition Table ================\n";
-    
-    // Column headers
-    cout << left 
-         << setw(ARROW_WIDTH) << " "
-         << setw(STATE_WIDTH) << "State";
-    
-    // Alphabet symbols as column headers
-    for (char symbol : alphabet) {
-        cout << left << setw(TRANS_WIDTH) << symbol;
-    }
-    cout << endl;
-
-    // Separator line
-    cout << string(ARROW_WIDTH + STATE_WIDTH + 
-                  alphabet.size() * TRANS_WIDTH, '-') << endl;
-
-    // Sort states for minimized DFA
-    vector<string> sortedStates = states;
-    if (!sortedStates.empty() && sortedStates[0][0] == 'Q') {
-        sort(sortedStates.begin(), sortedStates.end(), 
-            [](const string& a, const string& b) {
-                return stoi(a.substr(1)) < stoi(b.substr(1));
-            });
-    }
-
-    // Display transitions
-    for (const auto& state : sortedStates) {
-        // Start state marker
-        cout << left << setw(ARROW_WIDTH) << (state == startState ? "->" : "  ");
-        
-        // State name with accepting state marker (+)
-        string stateName = state;
-        if (acceptingStates.count(state)) {
-            stateName += "+";
-        }
-        cout << left << setw(STATE_WIDTH) << stateName;
-        
-        // Transitions
-        for (char symbol : alphabet) {
-            if (transitions.count(state) && transitions.at(state).count(symbol)) {
-                const auto& dests = transitions.at(state).at(symbol);
-                string destStr = dests.size() == 1 ? *dests.begin() : setToStateName(dests);
-                cout << left << setw(TRANS_WIDTH) << destStr;
-            } else {
-                cout << left << setw(TRANS_WIDTH) << "-";
-            }
-        }
-        cout << endl;
-    }
-    
-    cout << "=================================================\n";
+    OutputBuffer out(cout);
+    exportAutomaton(*this, ExportFormat::Table, out, title);
 }
 
 // Check if the automaton is a DFA.
@@ -238,290 +253,563 @@ bool Automaton::checkIfDFA() {
 
 // Complete the DFA by adding a sink state for any undefined transitions
 void Automaton::completeDFA() {
-    bool needSinkState = false;
-    
+    STATS_PHASE("complete");
     // Check if any state is missing a transition
-    for (const auto& state : states) {
-        for (char symbol : alphabet) {
-            if (transitions[state][symbol].empty()) {
-                needSinkState = true;
-                break;
-            }
-        }
-        if (needSinkState) break;
-    }
-    
+    bool needSinkState = find(transitions.begin(), transitions.end(), NO_STATE) != transitions.end();
+
     // Add a sink state if needed
     if (needSinkState) {
-        string sinkState = "qd";
+        string sinkName = "qd";
         // Only add sink state if it doesn't already exist.
-        if(find(states.begin(), states.end(), sinkState) == states.end()){
-            states.push_back(sinkState);
-            numStates++;
+        StateId sinkState = findState(sinkName);
+        if (sinkState == NO_STATE) {
+            sinkState = addState(sinkName);
         }
-        for (char symbol : alphabet) {
-            transitions[sinkState][symbol].insert(sinkState);
+        deadStates[sinkState] = true;
+        for (size_t col = 0; col < numColumns; ++col) {
+            transitions[(size_t)sinkState * numColumns + col] = sinkState;
         }
         // For each state, assign missing transitions to sink state.
-        for (const auto& state : states) {
-            for (char symbol : alphabet) {
-                if (transitions[state][symbol].empty()) {
-                    transitions[state][symbol].insert(sinkState);
-                }
-            }
+        for (StateId& dest : transitions) {
+            if (dest == NO_STATE) dest = sinkState;
         }
-        cout << "Added sink state '" << sinkState << "' for undefined transitions." << endl;
+        reachabilityValid = false;
+        if (verbose) cout << "Added sink state '" << sinkName << "' for undefined transitions." << endl;
     }
 }
 
 void Automaton::DeadStateLogic() {
+    STATS_PHASE("dead_state_logic");
     // Ensure dead states are not marked as accepting:
-    for (const auto& deadState : deadStates) {
-        if (acceptingStates.count(deadState)) {
-            cout << "Removing dead state '" << deadState << "' from accepting states.\n";
-            acceptingStates.erase(deadState);
+    for (StateId s = 0; s < numStates; ++s) {
+        if (deadStates[s] && acceptingStates[s]) {
+            if (verbose) cout << "Removing dead state '" << stateNames[s] << "' from accepting states.\n";
+            acceptingStates[s] = false;
         }
     }
 
     // For every dead state, enforce self-loop transitions on all symbols.
-    for (const auto& deadState : deadStates) {
-        for (char symbol : alphabet) {
-            transitions[deadState][symbol].clear();
-            transitions[deadState][symbol].insert(deadState);
+    for (StateId s = 0; s < numStates; ++s) {
+        if (!deadStates[s]) continue;
+        for (size_t col = 0; col < numColumns; ++col) {
+            transitions[(size_t)s * numColumns + col] = s;
         }
     }
-    cout << "DeadStateLogic applied: All dead state transitions now loop back to themselves.\n";
+    reachabilityValid = false;
+    if (verbose) cout << "DeadStateLogic applied: All dead state transitions now loop back to themselves.\n";
 }
 
-void Automaton::removeUnreachableStates() {
-    set<string> reachable;
-    queue<string> q;
-    q.push(startState);
-    reachable.insert(startState);
-
-    while (!q.empty()) {
-        string curr = q.front();
-        q.pop();
-        for (char symbol : alphabet) {
-            for (const auto& next : transitions[curr][symbol]) {
-                if (reachable.count(next) == 0) {
-                    reachable.insert(next);
-                    q.push(next);
-                }
+void Automaton::computeReachability() {
+    STATS_PHASE("reachability");
+    const size_t k = numColumns;
+    const size_t words = (numStates + 63) / 64;
+    // Frontiers at least this large are expanded by several threads
+    const size_t PARALLEL_FRONTIER = 1 << 16;
+    const unsigned threads = max(1u, thread::hardware_concurrency());
+
+    unique_ptr<atomic<uint64_t>[]> bits(new atomic<uint64_t>[words]);
+    for (size_t w = 0; w < words; ++w) bits[w].store(0, memory_order_relaxed);
+    // Set the bit of s; true if this call was the one that set it
+    auto visit = [&bits](StateId s) {
+        uint64_t bit = (uint64_t)1 << (s & 63);
+        if (bits[s >> 6].load(memory_order_relaxed) & bit) return false;
+        return !(bits[s >> 6].fetch_or(bit, memory_order_relaxed) & bit);
+    };
+    auto expand = [&](const StateId* begin, const StateId* end, vector<StateId>& out) {
+        for (const StateId* it = begin; it != end; ++it) {
+            const StateId* row = &transitions[(size_t)*it * k];
+            for (size_t col = 0; col < k; ++col) {
+                StateId next = row[col];
+                if (next != NO_STATE && visit(next)) out.push_back(next);
             }
         }
+    };
+
+    vector<StateId> frontier, nextFrontier;
+    vector<vector<StateId>> local(threads);
+    reachableCount = 0;
+    if (numStates > 0) {
+        visit(startState);
+        frontier.push_back(startState);
+        reachableCount = 1;
+    }
+    while (!frontier.empty()) {
+        nextFrontier.clear();
+        if (frontier.size() < PARALLEL_FRONTIER || threads == 1) {
+            expand(frontier.data(), frontier.data() + frontier.size(), nextFrontier);
+        } else {
+            utils::parallelFor(threads, frontier.size(), [&](size_t begin, size_t end, unsigned t) {
+                local[t].clear();
+                expand(frontier.data() + begin, frontier.data() + end, local[t]);
+            });
+            for (const auto& part : local) nextFrontier.insert(nextFrontier.end(), part.begin(), part.end());
+        }
+        reachableCount += (StateId)nextFrontier.size();
+        frontier.swap(nextFrontier);
+    }
+
+    reachable.resize(words);
+    for (size_t w = 0; w < words; ++w) reachable[w] = bits[w].load(memory_order_relaxed);
+    reachabilityValid = true;
+    STATS_BYTES("reachability", vectorBytes(reachable) + vectorBytes(frontier) + vectorBytes(nextFrontier));
+}
+
+void Automaton::removeUnreachableStates() {
+    STATS_PHASE("remove_unreachable");
+    if (!reachabilityValid) computeReachability();
+    const size_t k = numColumns;
+
+    // Assign compact IDs to reachable states, preserving their relative order
+    vector<StateId> remap(numStates, NO_STATE);
+    StateId kept = 0;
+    for (StateId s = 0; s < numStates; ++s) {
+        if ((reachable[s >> 6] >> (s & 63)) & 1) remap[s] = kept++;
     }
 
-    // Now filter all sets/maps to keep only reachable states
-    vector<string> newStates;
-    for (const auto& s : states) {
-        if (reachable.count(s)) {
-            newStates.push_back(s);
+    // Move every kept state's row and flags down to its new ID
+    for (StateId s = 0; s < numStates; ++s) {
+        StateId id = remap[s];
+        if (id == NO_STATE) continue;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            transitions[(size_t)id * k + col] = dest == NO_STATE ? NO_STATE : remap[dest];
         }
+        if (id != s) stateNames[id] = move(stateNames[s]);
+        acceptingStates[id] = acceptingStates[s];
+        deadStates[id] = deadStates[s];
+    }
+    numStates = kept;
+    stateNames.resize(kept);
+    acceptingStates.resize(kept);
+    deadStates.resize(kept);
+    transitions.resize((size_t)kept * k);
+    startState = remap[startState];
+
+    // Every remaining state is reachable
+    reachable.assign((kept + 63) / 64, ~(uint64_t)0);
+    if (kept % 64) reachable.back() = ((uint64_t)1 << (kept % 64)) - 1;
+    reachableCount = kept;
+    reachabilityValid = true;
+
+    if (verbose) {
+        cout << "Removed unreachable states. Remaining states: ";
+        for (const auto& s : stateNames) cout << s << " ";
+        cout << endl;
     }
-    states = newStates;
+}
 
-    set<string> newAccepting, newDead;
-    for (const auto& s : acceptingStates) {
-        if (reachable.count(s)) newAccepting.insert(s);
+void Automaton::computeCoReachability(vector<bool>& live, bool reachableOnly) {
+    const size_t k = numColumns;
+    const StateId n = numStates;
+    if (reachableOnly && !reachabilityValid) computeReachability();
+    auto counted = [&](StateId s) { return !reachableOnly || ((reachable[s >> 6] >> (s & 63)) & 1); };
+
+    // Predecessors of every state over all columns: count, prefix-sum, then fill
+    vector<size_t> predOffsets(n + 1, 0);
+    for (StateId s = 0; s < n; ++s) {
+        if (!counted(s)) continue;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            if (dest != NO_STATE) ++predOffsets[dest + 1];
+        }
     }
-    for (const auto& s : deadStates) {
-        if (reachable.count(s)) newDead.insert(s);
+    for (StateId s = 0; s < n; ++s) predOffsets[s + 1] += predOffsets[s];
+    vector<StateId> preds(predOffsets[n]);
+    for (StateId s = 0; s < n; ++s) {
+        if (!counted(s)) continue;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            if (dest != NO_STATE) preds[predOffsets[dest]++] = s;
+        }
+    }
+    for (StateId s = n; s > 0; --s) predOffsets[s] = predOffsets[s - 1];
+    predOffsets[0] = 0;
+    STATS_BYTES("co_reachability", vectorBytes(predOffsets) + vectorBytes(preds));
+
+    // Backward search from the accepting states
+    live.assign(n, false);
+    vector<StateId> stack;
+    for (StateId s = 0; s < n; ++s) {
+        if (acceptingStates[s] && counted(s)) {
+            live[s] = true;
+            stack.push_back(s);
+        }
+    }
+    while (!stack.empty()) {
+        StateId s = stack.back();
+        stack.pop_back();
+        for (size_t i = predOffsets[s]; i < predOffsets[s + 1]; ++i) {
+            if (!live[preds[i]]) {
+                live[preds[i]] = true;
+                stack.push_back(preds[i]);
+            }
+        }
     }
+}
 
-    acceptingStates = newAccepting;
-    deadStates = newDead;
+StateId Automaton::collapseDeadStates(bool keepSink) {
+    STATS_PHASE("dead_states");
+    const size_t k = numColumns;
+    vector<bool> live;
+    computeCoReachability(live, false);
+    StateId firstDead = NO_STATE;
+    for (StateId s = 0; s < numStates && firstDead == NO_STATE; ++s) {
+        if (!live[s]) firstDead = s;
+    }
+    if (firstDead == NO_STATE) return 0;
+
+    // One dead state survives: the lowest-numbered one as the sink, or without a sink a
+    // dead start state, which stays as the only state of an empty language. Live states
+    // keep their relative order, so the quotient numbering does not change.
+    StateId keptDead = keepSink ? firstDead : live[startState] ? NO_STATE : startState;
+    vector<StateId> remap(numStates, NO_STATE);
+    StateId kept = 0;
+    for (StateId s = 0; s < numStates; ++s) {
+        if (live[s] || s == keptDead) remap[s] = kept++;
+    }
+    // Where transitions into dead states (and undefined ones, if there is a sink) now go
+    const StateId into = keepSink ? remap[keptDead] : NO_STATE;
+
+    // Move every kept row down to its new ID in one pass
+    bool hadUndefined = false;
+    for (StateId s = 0; s < numStates; ++s) {
+        StateId id = remap[s];
+        if (id == NO_STATE) continue;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            hadUndefined |= live[s] && dest == NO_STATE;
+            transitions[(size_t)id * k + col] = !live[s] || dest == NO_STATE || !live[dest] ? into : remap[dest];
+        }
+        if (id != s) stateNames[id] = move(stateNames[s]);
+        acceptingStates[id] = acceptingStates[s];
+        deadStates[id] = deadStates[s] || !live[s];
+    }
+    const StateId removed = numStates - kept;
+    startState = remap[live[startState] ? startState : keptDead];
+    numStates = kept;
+    stateNames.resize(kept);
+    acceptingStates.resize(kept);
+    deadStates.resize(kept);
+    transitions.resize((size_t)kept * k);
+    reachabilityValid = false;
+
+    STATS_ADD("dead_states_removed", removed);
+    if (verbose && removed > 0) {
+        if (keepSink) {
+            cout << "Collapsed " << removed + 1 << " dead states into '" << stateNames[into] << "'.\n";
+        } else {
+            cout << "Removed " << removed << " dead states.\n";
+        }
+    }
+    if (verbose && keepSink && hadUndefined) {
+        cout << "Sent undefined transitions to dead state '" << stateNames[into] << "'.\n";
+    }
+    return removed;
+}
 
-    // Prune transitions to keep only reachable state transitions
-    map<string, map<char, set<string>>> newTransitions;
-    for (const auto& entry : transitions) {
-        const string& state = entry.first;
-        const auto& transMap = entry.second;
+bool Automaton::hasUnreachableStates() {
+    if (!reachabilityValid) computeReachability();
+    return reachableCount != numStates;
+}
 
-        if (!reachable.count(state)) continue;
-        for (const auto& pair : transMap) {
-            const char& symbol = pair.first;
-            const set<string>& dests = pair.second;
-            for (const auto& dest : dests) {
-                if (reachable.count(dest)) {
-                    newTransitions[state][symbol].insert(dest);
-                }
+void Automaton::compressAlphabet() {
+    const size_t k = numColumns;
+    if (k < 2) return;
+    STATS_PHASE("compress_alphabet");
+
+    // Hash every column over all states, then confirm candidate matches cell by cell
+    vector<uint64_t> columnHash(k, 0);
+    for (StateId s = 0; s < numStates; ++s) {
+        const StateId* row = &transitions[(size_t)s * k];
+        for (size_t col = 0; col < k; ++col) {
+            columnHash[col] = (columnHash[col] ^ row[col]) * 0x100000001B3ULL;
+        }
+    }
+    auto sameColumn = [&](size_t a, size_t b) {
+        if (columnHash[a] != columnHash[b]) return false;
+        for (StateId s = 0; s < numStates; ++s) {
+            if (transitions[(size_t)s * k + a] != transitions[(size_t)s * k + b]) return false;
+        }
+        return true;
+    };
+
+    // Each column maps to the first column identical to it; those become the new columns
+    vector<size_t> newColumn(k);
+    vector<size_t> representatives;
+    for (size_t col = 0; col < k; ++col) {
+        size_t found = representatives.size();
+        for (size_t i = 0; i < representatives.size(); ++i) {
+            if (sameColumn(representatives[i], col)) {
+                found = i;
+                break;
             }
         }
+        if (found == representatives.size()) representatives.push_back(col);
+        newColumn[col] = found;
     }
+    const size_t m = representatives.size();
+    if (m == k) return;
 
-    transitions = newTransitions;
+    // Compact in place: new cell (s, j) never lies after old cell (s, representatives[j])
+    for (StateId s = 0; s < numStates; ++s) {
+        for (size_t j = 0; j < m; ++j) {
+            transitions[(size_t)s * m + j] = transitions[(size_t)s * k + representatives[j]];
+        }
+    }
+    transitions.resize((size_t)numStates * m);
+    for (char symbol : alphabet) {
+        int& col = symbolToColumn[(unsigned char)symbol];
+        col = (int)newColumn[col];
+    }
+    numColumns = m;
+    if (verbose) cout << "Compressed alphabet: " << alphabet.size() << " symbols in " << m << " classes.\n";
+}
 
-    cout << "Removed unreachable states. Remaining states: ";
-    for (const auto& s : states) cout << s << " ";
-    cout << endl;
+void Automaton::expandAlphabet() {
+    if (numColumns == alphabet.size()) return;
+    const size_t k = numColumns;
+    const size_t wide = alphabet.size();
+    vector<StateId> expanded((size_t)numStates * wide);
+    for (StateId s = 0; s < numStates; ++s) {
+        for (size_t i = 0; i < wide; ++i) {
+            expanded[(size_t)s * wide + i] = transitions[(size_t)s * k + symbolToColumn[(unsigned char)alphabet[i]]];
+        }
+    }
+    transitions.swap(expanded);
+    for (size_t i = 0; i < wide; ++i) symbolToColumn[(unsigned char)alphabet[i]] = (int)i;
+    numColumns = wide;
 }
 
-bool Automaton::hasUnreachableStates() {
-    set<string> reachable;
-    queue<string> q;
-    q.push(startState);
-    reachable.insert(startState);
-
-    // BFS to find all reachable states
-    while (!q.empty()) {
-        string curr = q.front();
-        q.pop();
-        for (char symbol : alphabet) {
-            for (const auto& next : transitions[curr][symbol]) {
-                if (reachable.count(next) == 0) {
-                    reachable.insert(next);
-                    q.push(next);
-                }
+void Automaton::canonicalize() {
+    STATS_PHASE("canonicalize");
+    // Identical columns share a class; the first pass (if any) already reported
+    bool wasVerbose = verbose;
+    verbose = false;
+    compressAlphabet();
+    verbose = wasVerbose;
+    const size_t k = numColumns;
+
+    // Classes in order of their lowest symbol
+    vector<size_t> oldColumn;
+    vector<int> newColumn(k, -1);
+    for (char symbol : alphabet) {
+        int col = symbolToColumn[(unsigned char)symbol];
+        if (newColumn[col] >= 0) continue;
+        newColumn[col] = (int)oldColumn.size();
+        oldColumn.push_back(col);
+    }
+
+    // Breadth-first numbering from the start state, successors taken in class order;
+    // unreachable states keep their relative order after the reachable ones
+    vector<StateId> newId(numStates, NO_STATE);
+    vector<StateId> order;
+    order.reserve(numStates);
+    if (numStates > 0) {
+        newId[startState] = 0;
+        order.push_back(startState);
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        const StateId* row = &transitions[(size_t)order[i] * k];
+        for (size_t j = 0; j < k; ++j) {
+            StateId dest = row[oldColumn[j]];
+            if (dest != NO_STATE && newId[dest] == NO_STATE) {
+                newId[dest] = (StateId)order.size();
+                order.push_back(dest);
             }
         }
     }
+    for (StateId s = 0; s < numStates; ++s) {
+        if (newId[s] == NO_STATE) {
+            newId[s] = (StateId)order.size();
+            order.push_back(s);
+        }
+    }
 
-    return reachable.size() != states.size();
+    permuteStates(order);
+
+    // Columns in class order, then names that follow the new numbering
+    vector<StateId> row(k);
+    for (StateId id = 0; id < numStates; ++id) {
+        StateId* cells = &transitions[(size_t)id * k];
+        for (size_t j = 0; j < k; ++j) row[j] = cells[oldColumn[j]];
+        copy(row.begin(), row.end(), cells);
+        stateNames[id] = "Q" + to_string(id);
+    }
+    for (char symbol : alphabet) {
+        int& col = symbolToColumn[(unsigned char)symbol];
+        col = newColumn[col];
+    }
 }
 
-// Minimize DFA using Hopcroft's algorithm.
-Automaton Automaton::minimizeDFA() {
-    // Ensure the DFA is complete (every state has a transition for each symbol)
+void Automaton::permuteStates(const vector<StateId>& order) {
+    STATS_PHASE("permute");
+    const size_t k = numColumns;
+    vector<StateId> newId(numStates);
+    for (StateId id = 0; id < numStates; ++id) newId[order[id]] = id;
+
+    vector<StateId> renumbered((size_t)numStates * k);
+    vector<bool> accepting(numStates), dead(numStates);
+    vector<string> names(numStates);
+    for (StateId id = 0; id < numStates; ++id) {
+        StateId s = order[id];
+        accepting[id] = acceptingStates[s];
+        dead[id] = deadStates[s];
+        names[id].swap(stateNames[s]);
+        const StateId* row = &transitions[(size_t)s * k];
+        for (size_t col = 0; col < k; ++col) {
+            renumbered[(size_t)id * k + col] = row[col] == NO_STATE ? NO_STATE : newId[row[col]];
+        }
+    }
+    transitions.swap(renumbered);
+    acceptingStates.swap(accepting);
+    deadStates.swap(dead);
+    stateNames.swap(names);
+    if (numStates > 0) startState = newId[startState];
+    reachabilityValid = false;
+}
+
+Automaton Automaton::buildQuotient(const vector<BlockId>& blockOf, size_t numBlocks) const {
+    Automaton minimized;
+    vector<StateId> newStateOf;
+    buildQuotient(blockOf, numBlocks, newStateOf, minimized);
+    return minimized;
+}
+
+void Automaton::buildQuotient(const vector<BlockId>& blockOf, size_t numBlocks,
+                              vector<StateId>& newStateOf, Automaton& minimized) const {
+    STATS_PHASE("quotient");
+    const size_t k = numColumns;
+
+    // The block holding the start state becomes Q0, the others Q1, Q2, ... in order of
+    // their lowest-numbered member, so the result does not depend on how blocks were numbered
+    newStateOf.assign(numBlocks, NO_STATE);
+    newStateOf[blockOf[startState]] = 0;
+    StateId qNum = 1;
+    for (StateId s = 0; s < numStates; ++s) {
+        if (blockOf[s] != NO_STATE && newStateOf[blockOf[s]] == NO_STATE) newStateOf[blockOf[s]] = qNum++;
+    }
+
+    // Every field is overwritten, so whatever minimized held before only lends its buffers
+    minimized.alphabet = this->alphabet;
+    minimized.symbolToColumn = this->symbolToColumn;
+    minimized.numColumns = this->numColumns;
+    minimized.numStates = (StateId)numBlocks;
+    minimized.startState = 0;
+    minimized.isDFA = true;
+    minimized.verbose = this->verbose;
+    minimized.reachabilityValid = false;
+    minimized.stateNames.resize(numBlocks);
+    for (StateId id = 0; id < numBlocks; ++id) minimized.stateNames[id] = "Q" + to_string(id);
+    minimized.transitions.resize(numBlocks * k);
+
+    // A block is accepting if any member is and dead only if all members are. Members of
+    // a block have the same row up to blocks, so each member simply writes its row.
+    minimized.acceptingStates.assign(numBlocks, false);
+    minimized.deadStates.assign(numBlocks, true);
+    for (StateId s = 0; s < numStates; ++s) {
+        if (blockOf[s] == NO_STATE) continue;
+        StateId newState = newStateOf[blockOf[s]];
+        if (acceptingStates[s]) minimized.acceptingStates[newState] = true;
+        if (!deadStates[s]) minimized.deadStates[newState] = false;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            minimized.transitions[(size_t)newState * k + col] =
+                dest == NO_STATE || blockOf[dest] == NO_STATE ? NO_STATE : newStateOf[blockOf[dest]];
+        }
+    }
+
+    // Merging states can make more columns identical; the first pass already reported
+    minimized.verbose = false;
+    minimized.compressAlphabet();
+    minimized.verbose = verbose;
+    STATS_BYTES("quotient", vectorBytes(minimized.transitions));
+}
+
+StateId Automaton::computeMinimalPartition(MinimizeScratch& scratch) {
+    // States that cannot reach an accepting state are all equivalent; merge them into one
+    // sink first so refinement never has to split them off one by one. Then ensure the
+    // DFA is complete (every state has a transition for each symbol) and work on symbol
+    // classes.
+    StateId collapsed = collapseDeadStates();
     completeDFA();
-    cout << "\nMinimizing DFA using Hopcroft's algorithm...\n";
+    compressAlphabet();
+    if (verbose) cout << "\nMinimizing DFA using Hopcroft's algorithm...\n";
+    const size_t k = numColumns;
+    STATS_BYTES("transitions", vectorBytes(transitions));
 
     // -------------------------------
-    // 1. INITIAL PARTITIONING
+    // 1. INVERSE TRANSITIONS AND INITIAL PARTITIONING
     // -------------------------------
-    set<string> finalStates = acceptingStates; 
-    set<string> nonFinalStates;
-    for (const auto& state : states) {
-        if (acceptingStates.find(state) == acceptingStates.end())
-            nonFinalStates.insert(state);
+    {
+        STATS_PHASE("inverse");
+        buildInverseTransitions(transitions, numStates, k, scratch.invOffsets, scratch.invSources);
     }
-    
-    vector<set<string>> P;
-    if (!finalStates.empty())
-        P.push_back(finalStates);
-    if (!nonFinalStates.empty())
-        P.push_back(nonFinalStates);
-    
-    vector<set<string>> W;
-    if (!finalStates.empty() && finalStates.size() <= nonFinalStates.size())
-        W.push_back(finalStates);
-    else if (!nonFinalStates.empty())
-        W.push_back(nonFinalStates);
-    
+    STATS_BYTES("inverse", vectorBytes(scratch.invOffsets) + vectorBytes(scratch.invSources));
+
+    Partition& P = scratch.partition;
+    P.reset(numStates);
+    for (StateId state = 0; state < numStates; ++state) {
+        if (acceptingStates[state]) P.mark(state);
+    }
+    scratch.splits.clear();
+    P.splitMarked(scratch.splits);
+
     // -------------------------------
     // 2. REFINING THE PARTITION (Hopcroft's loop)
     // -------------------------------
-    while (!W.empty()) {
-        set<string> A = W.back();
-        W.pop_back();
-        for (char symbol : alphabet) {
-            set<string> X;
-            for (const auto& s : states) {
-                if (!transitions[s][symbol].empty()) {
-                    string dest = *(transitions[s][symbol].begin());
-                    if (A.find(dest) != A.end()) {
-                        X.insert(s);
-                    }
-                }
-            }
-            vector<set<string>> newP;
-            for (auto& Y : P) {
-                set<string> intersection, difference;
-                for (const auto& s : Y) {
-                    if (X.find(s) != X.end())
-                        intersection.insert(s);
-                    else
-                        difference.insert(s);
-                }
-                if (!intersection.empty() && !difference.empty()) {
-                    newP.push_back(intersection);
-                    newP.push_back(difference);
-                    auto it = find(W.begin(), W.end(), Y);
-                    if (it != W.end()) {
-                        W.erase(it);
-                        W.push_back(intersection);
-                        W.push_back(difference);
-                    } else {
-                        if (intersection.size() <= difference.size())
-                            W.push_back(intersection);
-                        else
-                            W.push_back(difference);
-                    }
-                } else {
-                    newP.push_back(Y);
-                }
-            }
-            P = newP;
-        }
-    }
+    STATS_PHASE("refine");
+    refinePartition(scratch, k);
+    return collapsed;
+}
+
+// Minimize DFA using Hopcroft's algorithm.
+Automaton Automaton::minimizeDFA() & {
+    MinimizeScratch scratch;
+    return minimizeDFA(scratch, false);
+}
+
+Automaton Automaton::minimizeDFA() && {
+    MinimizeScratch scratch;
+    return minimizeDFA(scratch, true);
+}
+
+Automaton Automaton::minimizeDFA(MinimizeScratch& scratch, bool consume) {
+    STATS_PHASE("minimize");
+    StateId collapsed = computeMinimalPartition(scratch);
 
     // -------------------------------
     // 3. CHECK IF ALREADY MINIMIZED
-    if (P.size() == states.size()) {
-        cout << "The DFA is already minimized.\n";
+    const Partition& P = scratch.partition;
+    if (collapsed == 0 && P.blockCount() == numStates) {
+        if (verbose) cout << "The DFA is already minimized.\n";
+        if (consume) return move(*this);
         return *this;
     }
 
     // -------------------------------
     // 4. BUILDING THE MINIMIZED DFA
-    map<string, string> stateToNewState;
-    vector<string> newStateNames(P.size());
-    int startIdx = -1;
-
-    // Find the partition containing the original start state
-    for (size_t i = 0; i < P.size(); ++i) {
-        if (P[i].count(startState)) {
-            startIdx = i;
-            break;
-        }
-    }
-
-    // Assign Q0 to the start state partition
-    newStateNames[startIdx] = "Q0";
-    for (const auto& s : P[startIdx]) {
-        stateToNewState[s] = "Q0";
-    }
-
-    // Assign Q1, Q2, ... to the other partitions
-    int qNum = 1;
-    for (size_t i = 0; i < P.size(); ++i) {
-        if ((int)i == startIdx) continue;
-        string name = "Q" + to_string(qNum++);
-        newStateNames[i] = name;
-        for (const auto& s : P[i]) {
-            stateToNewState[s] = name;
-        }
-    }
-
     Automaton minimized;
-    minimized.alphabet = this->alphabet;
-    minimized.states.clear();
-    for (const auto& name : newStateNames) minimized.states.push_back(name);
-    minimized.numStates = minimized.states.size();
-    minimized.startState = "Q0";
-
-    for (size_t i = 0; i < P.size(); ++i) {
-        string newStateName = newStateNames[i];
-        bool isAccepting = false, allDead = true;
-        string representative = *(P[i].begin());
-        for (const auto& s : P[i]) {
-            if (acceptingStates.count(s)) isAccepting = true;
-            if (!deadStates.count(s)) allDead = false;
-        }
-        if (isAccepting) minimized.acceptingStates.insert(newStateName);
-        if (allDead) minimized.deadStates.insert(newStateName);
+    buildQuotient(P.blockIds(), P.blockCount(), scratch.blockMap, minimized);
+    return minimized;
+}
 
-        for (char symbol : alphabet) {
-            string dest = *(transitions[representative][symbol].begin());
-            string newDest = stateToNewState[dest];
-            minimized.transitions[newStateName][symbol].insert(newDest);
-        }
+bool Automaton::minimizeInPlace(MinimizeScratch& scratch) {
+    STATS_PHASE("minimize");
+    StateId collapsed = computeMinimalPartition(scratch);
+    const Partition& P = scratch.partition;
+    if (collapsed == 0 && P.blockCount() == numStates) {
+        if (verbose) cout << "The DFA is already minimized.\n";
+        return false;
     }
 
-    return minimized;
+    // Build into the automaton parked in scratch and trade places with it: this one takes
+    // the result, and its old buffers stay in scratch for the next call
+    buildQuotient(P.blockIds(), P.blockCount(), scratch.blockMap, scratch.quotient);
+    swap(*this, scratch.quotient);
+    return true;
 }
 
 // Utility: Convert a set of states to a state name (for debugging or power set construction)
 string Automaton::setToStateName(const set<string>& stateSet) {
     return utils::setToStateName(stateSet);
-}
\ No newline at end of file
+}
@@ -0,0 +1,189 @@
+#include "BatchMinimizer.h"
+#include "Partition.h"
+#include "Stats.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// One slot of the in-flight ring; slots are reused, and with them their buffers
+struct BatchJob {
+    Automaton automaton;
+    Nfa nfa;
+    bool isNfa;       // The record was an NFA, still to be determinized into `automaton`
+    bool loaded;
+    string error;
+    string output;
+    bool done;        // Minimized and waiting to be written (guarded by the output lock)
+};
+
+struct WorkerQueue {
+    mutex lock;
+    deque<size_t> jobs;   // Sequence numbers; the owner pops the front, thieves the back
+};
+
+}
+
+bool minimizeBatch(Tokenizer& in, FILE* out, unsigned numThreads, size_t window,
+                   bool partial, bool canonical, ResultCache* cache, BatchStats& stats, string& error) {
+    const unsigned threads = numThreads ? numThreads : max(1u, thread::hardware_concurrency());
+    window = max(window, (size_t)threads);
+    vector<BatchJob> ring(window);
+    vector<WorkerQueue> queues(threads);
+    for (BatchJob& job : ring) job.done = false;
+
+    // Workers sleep on workReady until a job is queued; `queued` counts jobs not yet claimed
+    mutex poolLock;
+    condition_variable workReady;
+    size_t queued = 0;
+    bool finished = false;
+
+    // Output side: records are written strictly in sequence
+    mutex outputLock;
+    condition_variable slotFree;
+    size_t nextToWrite = 0;
+    bool writeFailed = false;
+
+    auto take = [&](unsigned self) {
+        while (true) {
+            for (unsigned i = 0; i < threads; ++i) {
+                WorkerQueue& q = queues[(self + i) % threads];
+                lock_guard<mutex> guard(q.lock);
+                if (q.jobs.empty()) continue;
+                size_t seq;
+                if (i == 0) {
+                    seq = q.jobs.front();
+                    q.jobs.pop_front();
+                } else {
+                    seq = q.jobs.back();
+                    q.jobs.pop_back();
+                }
+                return seq;
+            }
+        }
+    };
+
+    auto complete = [&](size_t seq) {
+        lock_guard<mutex> guard(outputLock);
+        ring[seq % window].done = true;
+        bool advanced = false;
+        while (ring[nextToWrite % window].done) {
+            BatchJob& job = ring[nextToWrite % window];
+            if (!writeFailed && fwrite(job.output.data(), 1, job.output.size(), out) != job.output.size())
+                writeFailed = true;
+            job.done = false;
+            ++nextToWrite;
+            advanced = true;
+        }
+        if (advanced) slotFree.notify_one();
+    };
+
+    // Workers collect statistics into their own reports and fold them into the caller's
+    // report when they finish
+    StatsReport* callerStats = currentStats();
+    mutex statsLock;
+    atomic<size_t> determinizeFailed(0);
+    atomic<size_t> cacheFailed(0);
+
+    auto worker = [&](unsigned self) {
+        MinimizeScratch scratch;
+        StatsReport workerStats;
+        StatsScope statsScope(callerStats ? &workerStats : nullptr);
+        while (true) {
+            {
+                unique_lock<mutex> lock(poolLock);
+                workReady.wait(lock, [&] { return queued > 0 || finished; });
+                if (queued == 0) break;
+                --queued;
+            }
+            // The claim above guarantees that some queue holds a job for us
+            size_t seq = take(self);
+            BatchJob& job = ring[seq % window];
+            job.output.clear();
+            if (job.loaded && job.isNfa && !job.nfa.determinize(job.automaton, job.error)) {
+                job.loaded = false;
+                ++determinizeFailed;
+            }
+            if (job.loaded) {
+                Automaton& automaton = job.automaton;
+                automaton.setVerbose(false);
+                Hash128 key;
+                if (cache) key = ResultCache::key(automaton, partial);
+                if (cache && cache->find(key, automaton)) {
+                    formatAutomaton(automaton, job.output);
+                } else {
+                    if (partial) {
+                        automaton = move(automaton).minimizePartialDFA();
+                    } else {
+                        if (automaton.hasUnreachableStates()) automaton.removeUnreachableStates();
+                        automaton.minimizeInPlace(scratch);
+                    }
+                    if (canonical || cache) automaton.canonicalize();
+                    // A result that cannot be stored is still written out
+                    string cacheError;
+                    if (cache && !cache->insert(key, automaton, cacheError)) ++cacheFailed;
+                    formatAutomaton(automaton, job.output);
+                }
+            } else {
+                job.output = "# record " + to_string(seq + 1) + ": " + job.error + "\n";
+            }
+            complete(seq);
+        }
+        if (callerStats) {
+            lock_guard<mutex> guard(statsLock);
+            callerStats->merge(workerStats);
+        }
+    };
+
+    vector<thread> pool;
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+
+    stats.records = 0;
+    stats.failed = 0;
+    stats.cacheFailures = 0;
+    for (size_t seq = 0;; ++seq) {
+        {
+            unique_lock<mutex> lock(outputLock);
+            slotFree.wait(lock, [&] { return seq - nextToWrite < window || writeFailed; });
+            if (writeFailed) break;
+        }
+        if (in.peekToken() < 0) break;
+
+        // The slot's previous record has been written, so no worker touches it now
+        BatchJob& job = ring[seq % window];
+        job.loaded = loadRecord(in, job.automaton, job.nfa, job.isNfa, job.error);
+        ++stats.records;
+        if (!job.loaded) ++stats.failed;
+        {
+            lock_guard<mutex> guard(queues[seq % threads].lock);
+            queues[seq % threads].jobs.push_back(seq);
+        }
+        {
+            lock_guard<mutex> guard(poolLock);
+            ++queued;
+        }
+        workReady.notify_one();
+    }
+
+    {
+        lock_guard<mutex> guard(poolLock);
+        finished = true;
+    }
+    workReady.notify_all();
+    for (thread& t : pool) t.join();
+    stats.failed += determinizeFailed;
+    stats.cacheFailures = cacheFailed;
+
+    if (writeFailed || fflush(out) != 0) {
+        error = "writing the output failed";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,167 @@
+#include "BinaryFormat.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+static const char BINARY_MAGIC[8] = {'D', 'F', 'A', 'B', 'I', 'N', '\r', '\n'};
+
+static uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static uint64_t bitsetBytes(uint64_t numStates) {
+    return (numStates + 63) / 64 * sizeof(uint64_t);
+}
+
+BinaryHeader makeBinaryHeader(StateId numStates, size_t numColumns, StateId startState) {
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_FORMAT_VERSION;
+    header.byteOrder = BINARY_BYTE_ORDER_MARK;
+    header.numStates = numStates;
+    header.numColumns = (uint32_t)numColumns;
+    header.startState = startState;
+    for (int c = 0; c < 256; ++c) header.symbolToColumn[c] = -1;
+    header.acceptingOffset = sizeof(BinaryHeader);
+    header.deadOffset = header.acceptingOffset + bitsetBytes(numStates);
+    header.transitionsOffset = alignUp(header.deadOffset + bitsetBytes(numStates), 64);
+    header.fileSize = header.transitionsOffset + (uint64_t)numStates * numColumns * sizeof(StateId);
+    return header;
+}
+
+bool saveAutomatonBinary(const Automaton& automaton, const string& path, string& error) {
+    const StateId n = automaton.getNumStates();
+    const size_t k = automaton.getNumColumns();
+
+    BinaryHeader header = makeBinaryHeader(n, k, automaton.getStartState());
+    for (int c = 0; c < 256; ++c) {
+        header.symbolToColumn[c] = (int16_t)automaton.getColumn((char)c);
+    }
+
+    bool minimizedNames = true;
+    for (StateId s = 0; s < n && minimizedNames; ++s) {
+        minimizedNames = automaton.getStateName(s) == "Q" + to_string(s);
+    }
+    if (minimizedNames) header.flags |= BINARY_FLAG_MINIMIZED_NAMES;
+
+    vector<uint64_t> accepting(bitsetBytes(n) / sizeof(uint64_t), 0);
+    vector<uint64_t> dead(accepting.size(), 0);
+    for (StateId s = 0; s < n; ++s) {
+        if (automaton.isAccepting(s)) accepting[s >> 6] |= (uint64_t)1 << (s & 63);
+        if (automaton.isDead(s)) dead[s >> 6] |= (uint64_t)1 << (s & 63);
+    }
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "cannot create '" + path + "'";
+        return false;
+    }
+    static const char padding[64] = {0};
+    const vector<StateId>& table = automaton.getTransitionTable();
+    uint64_t paddingBytes = header.transitionsOffset - header.deadOffset - bitsetBytes(n);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+        && fwrite(accepting.data(), sizeof(uint64_t), accepting.size(), out) == accepting.size()
+        && fwrite(dead.data(), sizeof(uint64_t), dead.size(), out) == dead.size()
+        && fwrite(padding, 1, paddingBytes, out) == paddingBytes
+        && fwrite(table.data(), sizeof(StateId), table.size(), out) == table.size();
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        error = "write to '" + path + "' failed";
+        return false;
+    }
+    return true;
+}
+
+bool isBinaryAutomatonFile(const string& path) {
+    char magic[sizeof(BINARY_MAGIC)];
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in) return false;
+    bool match = fread(magic, 1, sizeof(magic), in) == sizeof(magic)
+        && memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+    fclose(in);
+    return match;
+}
+
+bool MappedAutomaton::open(const string& path, string& error) {
+    header = nullptr;
+    if (!file.open(path, error)) return false;
+
+    const BinaryHeader* h = (const BinaryHeader*)file.bytes();
+    if (file.size() < sizeof(BinaryHeader) || memcmp(h->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+        error = "'" + path + "' is not a binary automaton file";
+        return false;
+    }
+    if (h->byteOrder != BINARY_BYTE_ORDER_MARK) {
+        error = "'" + path + "' was written with a different byte order";
+        return false;
+    }
+    if (h->version != BINARY_FORMAT_VERSION) {
+        error = "'" + path + "' has unsupported format version " + to_string(h->version);
+        return false;
+    }
+
+    uint64_t n = h->numStates;
+    uint64_t tableBytes = n * h->numColumns * sizeof(StateId);
+    bool sectionsOk = h->fileSize == file.size()
+        && h->acceptingOffset % 8 == 0 && h->deadOffset % 8 == 0 && h->transitionsOffset % 64 == 0
+        && h->acceptingOffset + bitsetBytes(n) <= h->fileSize
+        && h->deadOffset + bitsetBytes(n) <= h->fileSize
+        && h->transitionsOffset + tableBytes <= h->fileSize
+        && n > 0 && h->startState < n;
+    if (!sectionsOk) {
+        error = "'" + path + "' is truncated or has an inconsistent header";
+        return false;
+    }
+
+    header = h;
+    accepting = (const uint64_t*)(file.bytes() + h->acceptingOffset);
+    dead = (const uint64_t*)(file.bytes() + h->deadOffset);
+    transitions = (const StateId*)(file.bytes() + h->transitionsOffset);
+    return true;
+}
+
+bool MappedAutomaton::validate(string& error) const {
+    size_t cells = (size_t)header->numStates * header->numColumns;
+    for (size_t i = 0; i < cells; ++i) {
+        StateId dest = transitions[i];
+        if (dest != NO_STATE && dest >= header->numStates) {
+            error = "transition " + to_string(i) + " targets state " + to_string(dest)
+                + " out of range";
+            return false;
+        }
+    }
+    for (int c = 0; c < 256; ++c) {
+        if (header->symbolToColumn[c] >= (int)header->numColumns) {
+            error = "symbol " + to_string(c) + " maps to a column out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+Automaton MappedAutomaton::toAutomaton() const {
+    const StateId n = header->numStates;
+    const size_t k = header->numColumns;
+
+    // Symbols sharing a column (see compressAlphabet) keep sharing it
+    array<int, 256> columnOfSymbol;
+    for (int c = 0; c < 256; ++c) columnOfSymbol[c] = header->symbolToColumn[c];
+
+    Automaton automaton;
+    automaton.setAlphabetClasses(columnOfSymbol);
+    automaton.initStates(n);
+    automaton.setStartState(header->startState);
+    bool minimizedNames = header->flags & BINARY_FLAG_MINIMIZED_NAMES;
+    for (StateId s = 0; s < n; ++s) {
+        if (minimizedNames) automaton.setStateName(s, "Q" + to_string(s));
+        automaton.setAccepting(s, isAccepting(s));
+        automaton.setDead(s, isDead(s));
+        for (size_t col = 0; col < k; ++col) {
+            automaton.setTransition(s, col, getTransition(s, col));
+        }
+    }
+    return automaton;
+}
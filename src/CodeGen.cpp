@@ -0,0 +1,295 @@
+#include "CodeGen.h"
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+bool parseCodeStyle(const string& name, CodeStyle& style) {
+    if (name == "table") style = CodeStyle::Table;
+    else if (name == "switch") style = CodeStyle::Switch;
+    else return false;
+    return true;
+}
+
+namespace {
+
+// The DFA renumbered for code: row 0 is the reject sink, then non-accepting states,
+// then accepting states (the same layout as Matcher)
+struct CodeDfa {
+    uint32_t numStates;
+    uint32_t numClasses;                  // Symbol classes + 1 for bytes outside the alphabet
+    uint32_t start;
+    uint32_t firstAccepting;
+    vector<uint32_t> byteClass;           // Byte -> class
+    vector<uint32_t> transitions;         // Row x class -> row
+};
+
+void renumber(const Automaton& dfa, CodeDfa& code) {
+    const StateId n = dfa.getNumStates();
+    const size_t k = dfa.getNumColumns();
+    code.numClasses = (uint32_t)k + 1;
+    code.byteClass.resize(256);
+    for (int b = 0; b < 256; ++b) {
+        int col = dfa.getColumn((char)b);
+        code.byteClass[b] = col < 0 ? (uint32_t)k : (uint32_t)col;
+    }
+
+    // Non-accepting states that only loop to themselves behave exactly like the sink
+    vector<uint32_t> rowOf(n, 0);
+    uint32_t rows = 1;
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1) code.firstAccepting = rows;
+        for (StateId s = 0; s < n; ++s) {
+            if (dfa.isAccepting(s) != (pass == 1)) continue;
+            bool loops = pass == 0;
+            for (size_t col = 0; col < k && loops; ++col) {
+                StateId dest = dfa.getTransition(s, col);
+                loops = dest == s || dest == NO_STATE;
+            }
+            if (!loops) rowOf[s] = rows++;
+        }
+    }
+    code.numStates = rows;
+    code.start = n > 0 ? rowOf[dfa.getStartState()] : 0;
+    code.transitions.assign((size_t)rows * code.numClasses, 0);
+    for (StateId s = 0; s < n; ++s) {
+        if (rowOf[s] == 0) continue;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = dfa.getTransition(s, col);
+            code.transitions[(size_t)rowOf[s] * code.numClasses + col] = dest == NO_STATE ? 0 : rowOf[dest];
+        }
+    }
+}
+
+// Smallest unsigned type that holds every value below `limit`
+const char* valueType(uint64_t limit) {
+    return limit <= 0x100 ? "uint8_t" : limit <= 0x10000 ? "uint16_t" : "uint32_t";
+}
+
+// A byte as a case label: the character itself for letters and digits, hex otherwise
+void writeByte(OutputBuffer& out, unsigned char byte) {
+    static const char HEX[] = "0123456789ABCDEF";
+    if (isalnum(byte)) {
+        char literal[3] = {'\'', (char)byte, '\''};
+        out.write(literal, 3);
+        return;
+    }
+    char hex[4] = {'0', 'x', HEX[byte >> 4], HEX[byte & 15]};
+    out.write(hex, 4);
+}
+
+void writeCommon(const CodeDfa& code, OutputBuffer& out) {
+    out.write("// State 0 rejects every continuation; states from FIRST_ACCEPTING on accept\n");
+    out.write("constexpr uint32_t NUM_STATES = ");
+    out.writeUnsigned(code.numStates);
+    out.write(";\nconstexpr uint32_t START = ");
+    out.writeUnsigned(code.start);
+    out.write(";\nconstexpr uint32_t FIRST_ACCEPTING = ");
+    out.writeUnsigned(code.firstAccepting);
+    out.write(";\nstatic_assert(START < NUM_STATES && FIRST_ACCEPTING <= NUM_STATES, \"state numbering\");\n\n"
+              "constexpr bool isAccepting(uint32_t state) { return state >= FIRST_ACCEPTING; }\n\n");
+}
+
+void writeTable(const CodeDfa& code, OutputBuffer& out) {
+    writeCommon(code, out);
+    const char* classType = valueType(code.numClasses);
+    const char* stateType = valueType(code.numStates);
+
+    out.write("// The last class stands for every byte outside the alphabet\n");
+    out.write("constexpr uint32_t NUM_CLASSES = ");
+    out.writeUnsigned(code.numClasses);
+    out.write(";\n\nconstexpr ");
+    out.write(classType, strlen(classType));
+    out.write(" BYTE_CLASS[] = {");
+    for (int b = 0; b < 256; ++b) {
+        out.write(b % 16 == 0 ? "\n    " : " ", b % 16 == 0 ? 5 : 1);
+        out.writeUnsigned(code.byteClass[b]);
+        out.put(',');
+    }
+    out.write("\n};\nstatic_assert(sizeof(BYTE_CLASS) / sizeof(BYTE_CLASS[0]) == 256, \"one class per byte\");\n\n");
+
+    out.write("constexpr ");
+    out.write(stateType, strlen(stateType));
+    out.write(" TRANSITIONS[][NUM_CLASSES] = {\n");
+    for (uint32_t row = 0; row < code.numStates; ++row) {
+        out.write("    {");
+        for (uint32_t cls = 0; cls < code.numClasses; ++cls) {
+            if (cls) out.write(", ", 2);
+            out.writeUnsigned(code.transitions[(size_t)row * code.numClasses + cls]);
+        }
+        out.write("},\n");
+    }
+    out.write("};\nstatic_assert(sizeof(TRANSITIONS) / sizeof(TRANSITIONS[0]) == NUM_STATES, \"one row per state\");\n\n");
+
+    out.write("constexpr uint32_t step(uint32_t state, unsigned char byte) {\n"
+              "    return TRANSITIONS[state][BYTE_CLASS[byte]];\n"
+              "}\n\n"
+              "constexpr bool matches(std::string_view text) {\n"
+              "    uint32_t state = START;\n"
+              "    for (char c : text) {\n"
+              "        state = step(state, (unsigned char)c);\n"
+              "        if (state == 0) return false;\n"
+              "    }\n"
+              "    return isAccepting(state);\n"
+              "}\n\n"
+              "inline bool matches(const unsigned char* data, std::size_t length) {\n"
+              "    return matches(std::string_view(reinterpret_cast<const char*>(data), length));\n"
+              "}\n");
+}
+
+void writeSwitch(const CodeDfa& code, OutputBuffer& out) {
+    writeCommon(code, out);
+    out.write("inline bool matches(const unsigned char* data, std::size_t length) {\n"
+              "    const unsigned char* p = data;\n"
+              "    const unsigned char* const end = data + length;\n");
+    if (code.start == 0) {
+        out.write("    (void)p;\n    (void)end;\n    return false;\n}\n");
+    }
+
+    // States reachable from the start, in breadth-first order so that the start state
+    // comes first and is entered by falling through; it gets a label only if some
+    // transition leads back to it, so every emitted label is a jump target
+    vector<uint32_t> order;
+    bool startReentered = false;
+    vector<bool> queued(code.numStates, false);
+    if (code.start != 0) {
+        order.push_back(code.start);
+        queued[code.start] = true;
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        const uint32_t* row = &code.transitions[(size_t)order[i] * code.numClasses];
+        for (uint32_t cls = 0; cls < code.numClasses; ++cls) {
+            if (row[cls] == code.start) startReentered = true;
+            if (row[cls] != 0 && !queued[row[cls]]) {
+                queued[row[cls]] = true;
+                order.push_back(row[cls]);
+            }
+        }
+    }
+
+    vector<uint32_t> targetOf(256), count(code.numStates), targets;
+    for (uint32_t s : order) {
+        const uint32_t* row = &code.transitions[(size_t)s * code.numClasses];
+        if (s != code.start || startReentered) {
+            out.put('s');
+            out.writeUnsigned(s);
+            out.write(":\n");
+        }
+        out.write(s >= code.firstAccepting ? "    if (p == end) return true;\n" : "    if (p == end) return false;\n");
+        out.write("    switch (*p++) {\n");
+
+        // The most frequent target becomes the default branch
+        targets.clear();
+        for (int b = 0; b < 256; ++b) {
+            targetOf[b] = row[code.byteClass[b]];
+            if (count[targetOf[b]]++ == 0) targets.push_back(targetOf[b]);
+        }
+        uint32_t fallback = targets[0];
+        for (uint32_t t : targets) {
+            if (count[t] > count[fallback]) fallback = t;
+        }
+        for (uint32_t t : targets) {
+            if (t == fallback) continue;
+            size_t written = 0;
+            for (int b = 0; b < 256; ++b) {
+                if (targetOf[b] != t) continue;
+                out.write(written % 8 == 0 ? "    " : " ", written % 8 == 0 ? 4 : 1);
+                out.write("case ");
+                writeByte(out, (unsigned char)b);
+                out.put(':');
+                if (++written % 8 == 0) out.put('\n');
+            }
+            if (written % 8 != 0) out.put('\n');
+            if (t == 0) {
+                out.write("        return false;\n");
+            } else {
+                out.write("        goto s");
+                out.writeUnsigned(t);
+                out.write(";\n");
+            }
+        }
+        if (fallback == 0) {
+            out.write("    default:\n        return false;\n");
+        } else {
+            out.write("    default:\n        goto s");
+            out.writeUnsigned(fallback);
+            out.write(";\n");
+        }
+        out.write("    }\n");
+        for (uint32_t t : targets) count[t] = 0;
+    }
+    if (code.start != 0) out.write("}\n");
+
+    out.write("\ninline bool matches(std::string_view text) {\n"
+              "    return matches(reinterpret_cast<const unsigned char*>(text.data()), text.size());\n"
+              "}\n");
+}
+
+}
+
+bool generateCode(const Automaton& dfa, CodeStyle style, const string& name, OutputBuffer& out,
+                  string& error) {
+    bool valid = !name.empty() && !isdigit((unsigned char)name[0]);
+    for (char c : name) valid = valid && (isalnum((unsigned char)c) || c == '_');
+    if (!valid) {
+        error = "'" + name + "' is not a valid C++ identifier";
+        return false;
+    }
+    CodeDfa code;
+    renumber(dfa, code);
+
+    string guard;
+    for (char c : name) guard.push_back((char)toupper((unsigned char)c));
+    guard += "_DFA_H";
+    out.write("// Generated by dfa_minimization from a DFA with ");
+    out.writeUnsigned(dfa.getNumStates());
+    out.write(" states and ");
+    out.writeUnsigned(dfa.getNumColumns());
+    out.write(" symbol classes. Do not edit.\n#ifndef ");
+    out.write(guard);
+    out.write("\n#define ");
+    out.write(guard);
+    out.write("\n\n#include <cstddef>\n#include <cstdint>\n#include <string_view>\n\nnamespace ");
+    out.write(name);
+    out.write(" {\n\n");
+    if (style == CodeStyle::Table)
+        writeTable(code, out);
+    else
+        writeSwitch(code, out);
+    out.write("\n} // namespace ");
+    out.write(name);
+    out.write("\n\n#endif // ");
+    out.write(guard);
+    out.put('\n');
+    return true;
+}
+
+bool generateCodeFile(const Automaton& dfa, CodeStyle style, const string& path, string& error) {
+    string name = "dfa";
+    if (path != "-") {
+        size_t begin = path.find_last_of("/\\");
+        begin = begin == string::npos ? 0 : begin + 1;
+        size_t end = path.find('.', begin);
+        name = path.substr(begin, end == string::npos ? string::npos : end - begin);
+        for (char& c : name) {
+            if (!isalnum((unsigned char)c)) c = '_';
+        }
+        if (name.empty() || isdigit((unsigned char)name[0])) name = "dfa_" + name;
+    }
+    FILE* file = path == "-" ? stdout : fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "cannot open '" + path + "' for writing";
+        return false;
+    }
+    bool written;
+    {
+        OutputBuffer out(file);
+        written = generateCode(dfa, style, name, out, error) && out.flush();
+        if (!written && error.empty()) error = "writing '" + path + "' failed";
+    }
+    if (file != stdout && fclose(file) != 0 && written) {
+        error = "writing '" + path + "' failed";
+        written = false;
+    }
+    return written;
+}
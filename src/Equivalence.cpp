@@ -0,0 +1,129 @@
+#include "Equivalence.h"
+#include "Product.h"
+#include "Stats.h"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Union-find over StateIds with union by rank and path halving
+class DisjointSets {
+private:
+    vector<StateId> parent;
+    vector<uint8_t> rank;
+
+public:
+    explicit DisjointSets(size_t n) : parent(n), rank(n, 0) {
+        for (size_t i = 0; i < n; ++i) parent[i] = (StateId)i;
+    }
+
+    StateId find(StateId x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    // Merge the sets of a and b; false if they already were one set
+    bool unite(StateId a, StateId b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        if (rank[a] < rank[b]) swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) ++rank[a];
+        return true;
+    }
+};
+
+// A merged pair, with the pair and symbol it was reached from
+struct PairVisit {
+    StateId first;
+    StateId second;
+    size_t parent;
+    char symbol;
+};
+
+const size_t NO_PARENT = (size_t)-1;
+
+}
+
+bool acceptsString(const Automaton& dfa, const string& input) {
+    if (dfa.getNumStates() == 0) return false;
+    StateId s = dfa.getStartState();
+    for (char symbol : input) {
+        int col = dfa.getColumn(symbol);
+        if (col < 0) return false;
+        s = dfa.getTransition(s, col);
+        if (s == NO_STATE) return false;
+    }
+    return dfa.isAccepting(s);
+}
+
+bool checkEquivalence(const Automaton& first, const Automaton& second, bool& equivalent,
+                      string& counterexample, string& error) {
+    STATS_PHASE("equivalence");
+    const StateId n1 = first.getNumStates();
+    const StateId n2 = second.getNumStates();
+    if ((uint64_t)n1 + n2 + 1 >= NO_STATE) {
+        error = "too many states to compare (" + to_string(n1) + " + " + to_string(n2) + ")";
+        return false;
+    }
+    // Combined ids: the first automaton's states, then the second's, then the shared sink
+    const StateId sink = n1 + n2;
+
+    // Joint symbol classes: symbols with the same column in both automata behave alike
+    JointClasses classes;
+    computeJointClasses(first, second, classes);
+    const vector<int>& firstColumn = classes.firstColumn;
+    const vector<int>& secondColumn = classes.secondColumn;
+    const vector<char>& classSymbol = classes.symbol;
+    const size_t numClasses = classSymbol.size();
+
+    auto nextFirst = [&](StateId s, size_t cls) {
+        if (s == sink || firstColumn[cls] < 0) return sink;
+        StateId dest = first.getTransition(s, firstColumn[cls]);
+        return dest == NO_STATE ? sink : dest;
+    };
+    auto nextSecond = [&](StateId s, size_t cls) {
+        if (s == sink || secondColumn[cls] < 0) return sink;
+        StateId dest = second.getTransition(s - n1, secondColumn[cls]);
+        return dest == NO_STATE ? sink : n1 + dest;
+    };
+    auto accepts = [&](StateId s) {
+        if (s < n1) return first.isAccepting(s);
+        return s < sink && second.isAccepting(s - n1);
+    };
+
+    // Breadth-first over merged pairs; each push merges two sets, so at most n1 + n2 pairs
+    DisjointSets sets((size_t)sink + 1);
+    vector<PairVisit> pairs;
+    StateId start1 = n1 ? first.getStartState() : sink;
+    StateId start2 = n2 ? n1 + second.getStartState() : sink;
+    sets.unite(start1, start2);
+    pairs.push_back(PairVisit{start1, start2, NO_PARENT, 0});
+    for (size_t head = 0; head < pairs.size(); ++head) {
+        const PairVisit visit = pairs[head];
+        if (accepts(visit.first) != accepts(visit.second)) {
+            counterexample.clear();
+            for (size_t i = head; pairs[i].parent != NO_PARENT; i = pairs[i].parent) {
+                counterexample.push_back(pairs[i].symbol);
+            }
+            reverse(counterexample.begin(), counterexample.end());
+            STATS_ADD("equivalence_pairs", pairs.size());
+            equivalent = false;
+            return true;
+        }
+        for (size_t cls = 0; cls < numClasses; ++cls) {
+            StateId p = nextFirst(visit.first, cls);
+            StateId q = nextSecond(visit.second, cls);
+            if (sets.unite(p, q)) pairs.push_back(PairVisit{p, q, head, classSymbol[cls]});
+        }
+    }
+    STATS_ADD("equivalence_pairs", pairs.size());
+    equivalent = true;
+    return true;
+}
@@ -0,0 +1,309 @@
+#include "Export.h"
+#include "Utils.h"
+#include <algorithm>
+
+using namespace std;
+
+OutputBuffer::OutputBuffer(FILE* out, size_t capacity)
+    : file(out), stream(nullptr), target(nullptr), buffer(max<size_t>(capacity, 64)), len(0), failed(false) {}
+
+OutputBuffer::OutputBuffer(ostream& out, size_t capacity)
+    : file(nullptr), stream(&out), target(nullptr), buffer(max<size_t>(capacity, 64)), len(0), failed(false) {}
+
+OutputBuffer::OutputBuffer(string& out, size_t capacity)
+    : file(nullptr), stream(nullptr), target(&out), buffer(max<size_t>(capacity, 64)), len(0), failed(false) {}
+
+void OutputBuffer::emit(const char* data, size_t size) {
+    if (size == 0 || failed) return;
+    if (file) {
+        failed = fwrite(data, 1, size, file) != size;
+    } else if (stream) {
+        stream->write(data, (streamsize)size);
+        failed = stream->bad();
+    } else {
+        target->append(data, size);
+    }
+}
+
+bool OutputBuffer::flush() {
+    drain();
+    if (file && !failed && fflush(file) != 0) failed = true;
+    if (stream && !failed) failed = !stream->flush();
+    return !failed;
+}
+
+void OutputBuffer::writeUnsigned(uint64_t value) {
+    static const char DIGIT_PAIRS[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char digits[20];
+    char* p = digits + sizeof(digits);
+    while (value >= 100) {
+        const char* pair = DIGIT_PAIRS + (value % 100) * 2;
+        value /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (value >= 10) {
+        const char* pair = DIGIT_PAIRS + value * 2;
+        *--p = pair[1];
+        *--p = pair[0];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    write(p, digits + sizeof(digits) - p);
+}
+
+void OutputBuffer::fill(char c, size_t count) {
+    while (count > 0) {
+        if (len == buffer.size()) drain();
+        size_t chunk = min(count, buffer.size() - len);
+        memset(buffer.data() + len, c, chunk);
+        len += chunk;
+        count -= chunk;
+    }
+}
+
+bool parseExportFormat(const string& name, ExportFormat& format) {
+    if (name == "table") format = ExportFormat::Table;
+    else if (name == "text") format = ExportFormat::Text;
+    else if (name == "csv") format = ExportFormat::Csv;
+    else if (name == "dot") format = ExportFormat::Dot;
+    else return false;
+    return true;
+}
+
+namespace {
+
+// Left-justified in a field of `width` characters, like `left << setw(width)`
+void writePadded(OutputBuffer& out, const string& text, size_t width) {
+    out.write(text);
+    if (text.size() < width) out.fill(' ', width - text.size());
+}
+
+// A CSV field, quoted if it contains a separator, a quote or a line break
+string csvField(const string& text) {
+    if (text.find_first_of(",\"\r\n") == string::npos) return text;
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// A DOT string literal
+string dotString(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+void exportTable(const Automaton& automaton, OutputBuffer& out, const string& title) {
+    const StateId n = automaton.getNumStates();
+    const size_t k = automaton.getNumColumns();
+    const size_t ARROW_WIDTH = 4;
+    const size_t STATE_WIDTH = 10;
+    size_t transWidth = 10;
+
+    // Symbol classes label their column, e.g. "a" or "[0-9_]"
+    vector<string> labels(k);
+    for (size_t col = 0; col < k; ++col) {
+        labels[col] = utils::symbolClassLabel(automaton.getColumnSymbols(col));
+        transWidth = max(transWidth, labels[col].size() + 2);
+    }
+
+    out.put('\n');
+    out.write(title);
+    out.write("\n================ Transition Table ================\n");
+    writePadded(out, " ", ARROW_WIDTH);
+    writePadded(out, "State", STATE_WIDTH);
+    for (const string& label : labels) writePadded(out, label, transWidth);
+    out.put('\n');
+    out.fill('-', ARROW_WIDTH + STATE_WIDTH + k * transWidth);
+    out.put('\n');
+
+    // Rows in id order (minimized states are numbered so that ID order is name order)
+    for (StateId s = 0; s < n; ++s) {
+        out.write(s == automaton.getStartState() ? "->  " : "    ", ARROW_WIDTH);
+        const string& name = automaton.getStateName(s);
+        out.write(name);
+        size_t width = name.size();
+        if (automaton.isAccepting(s)) {
+            out.put('+');
+            ++width;
+        }
+        if (width < STATE_WIDTH) out.fill(' ', STATE_WIDTH - width);
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = automaton.getTransition(s, col);
+            if (dest != NO_STATE) {
+                writePadded(out, automaton.getStateName(dest), transWidth);
+            } else {
+                out.put('-');
+                out.fill(' ', transWidth - 1);
+            }
+        }
+        out.put('\n');
+    }
+    out.write("=================================================\n");
+}
+
+void exportText(const Automaton& automaton, OutputBuffer& out) {
+    const StateId n = automaton.getNumStates();
+    const size_t k = automaton.getNumColumns();
+    vector<string> labels(k);
+    for (size_t col = 0; col < k; ++col) {
+        labels[col] = " " + utils::symbolClassLabel(automaton.getColumnSymbols(col)) + " ";
+    }
+
+    out.write("dfa ");
+    out.writeUnsigned(n);
+    out.put(' ');
+    out.write(utils::symbolClassLabel(automaton.getAlphabet()));
+    out.write("\nstart ");
+    out.writeUnsigned(automaton.getStartState());
+    out.put('\n');
+    for (int pass = 0; pass < 2; ++pass) {
+        auto listed = [&](StateId s) { return pass == 0 ? automaton.isAccepting(s) : automaton.isDead(s); };
+        size_t count = 0;
+        for (StateId s = 0; s < n; ++s) {
+            if (listed(s)) ++count;
+        }
+        if (count == 0) continue;
+        out.write(pass == 0 ? "accept " : "dead ");
+        out.writeUnsigned(count);
+        for (StateId s = 0; s < n; ++s) {
+            if (!listed(s)) continue;
+            out.put(' ');
+            out.writeUnsigned(s);
+        }
+        out.put('\n');
+    }
+    for (StateId s = 0; s < n; ++s) {
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = automaton.getTransition(s, col);
+            if (dest == NO_STATE) continue;
+            out.writeUnsigned(s);
+            out.write(labels[col]);
+            out.writeUnsigned(dest);
+            out.put('\n');
+        }
+    }
+    out.write("end\n");
+}
+
+void exportCsv(const Automaton& automaton, OutputBuffer& out) {
+    const StateId n = automaton.getNumStates();
+    const size_t k = automaton.getNumColumns();
+    out.write("state,name,start,accepting");
+    for (size_t col = 0; col < k; ++col) {
+        out.put(',');
+        out.write(csvField(utils::symbolClassLabel(automaton.getColumnSymbols(col))));
+    }
+    out.put('\n');
+    for (StateId s = 0; s < n; ++s) {
+        out.writeUnsigned(s);
+        out.put(',');
+        out.write(csvField(automaton.getStateName(s)));
+        out.write(s == automaton.getStartState() ? ",1," : ",0,");
+        out.put(automaton.isAccepting(s) ? '1' : '0');
+        for (size_t col = 0; col < k; ++col) {
+            out.put(',');
+            StateId dest = automaton.getTransition(s, col);
+            if (dest != NO_STATE) out.writeUnsigned(dest);
+        }
+        out.put('\n');
+    }
+}
+
+void exportDot(const Automaton& automaton, OutputBuffer& out) {
+    const StateId n = automaton.getNumStates();
+    const size_t k = automaton.getNumColumns();
+    vector<vector<char>> columnSymbols(k);
+    vector<string> labels(k);
+    for (size_t col = 0; col < k; ++col) {
+        columnSymbols[col] = automaton.getColumnSymbols(col);
+        labels[col] = dotString(utils::symbolClassLabel(columnSymbols[col]));
+    }
+
+    out.write("digraph DFA {\n  rankdir=LR;\n  node [shape=circle];\n"
+              "  __start [shape=point, label=\"\"];\n");
+    if (n > 0) {
+        out.write("  __start -> ");
+        out.writeUnsigned(automaton.getStartState());
+        out.write(";\n");
+    }
+    vector<pair<StateId, size_t>> edges;    // (target, column) of one state, sorted by target
+    vector<char> symbols;
+    for (StateId s = 0; s < n; ++s) {
+        out.write("  ");
+        out.writeUnsigned(s);
+        out.write(" [label=");
+        out.write(dotString(automaton.getStateName(s)));
+        out.write(automaton.isAccepting(s) ? ", shape=doublecircle];\n" : "];\n");
+
+        edges.clear();
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = automaton.getTransition(s, col);
+            if (dest != NO_STATE) edges.push_back(make_pair(dest, col));
+        }
+        sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i + 1;
+            while (j < edges.size() && edges[j].first == edges[i].first) ++j;
+            out.write("  ");
+            out.writeUnsigned(s);
+            out.write(" -> ");
+            out.writeUnsigned(edges[i].first);
+            out.write(" [label=");
+            if (j == i + 1) {
+                out.write(labels[edges[i].second]);
+            } else {
+                // Every column to the same target becomes one edge labelled with their union
+                symbols.clear();
+                for (size_t e = i; e < j; ++e) {
+                    const vector<char>& more = columnSymbols[edges[e].second];
+                    symbols.insert(symbols.end(), more.begin(), more.end());
+                }
+                out.write(dotString(utils::symbolClassLabel(symbols)));
+            }
+            out.write("];\n");
+            i = j;
+        }
+    }
+    out.write("}\n");
+}
+
+}
+
+void exportAutomaton(const Automaton& automaton, ExportFormat format, OutputBuffer& out,
+                     const string& title) {
+    switch (format) {
+    case ExportFormat::Table: exportTable(automaton, out, title); break;
+    case ExportFormat::Text: exportText(automaton, out); break;
+    case ExportFormat::Csv: exportCsv(automaton, out); break;
+    case ExportFormat::Dot: exportDot(automaton, out); break;
+    }
+}
+
+bool exportAutomatonFile(const Automaton& automaton, ExportFormat format, const string& path,
+                         string& error) {
+    FILE* file = path == "-" ? stdout : fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "cannot open '" + path + "' for writing";
+        return false;
+    }
+    bool written;
+    {
+        OutputBuffer out(file);
+        exportAutomaton(automaton, format, out);
+        written = out.flush();
+    }
+    if (file != stdout && fclose(file) != 0) written = false;
+    if (!written) error = "writing '" + path + "' failed";
+    return written;
+}
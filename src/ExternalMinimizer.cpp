@@ -0,0 +1,420 @@
+#include "ExternalMinimizer.h"
+#include "BinaryFormat.h"
+#include "Stats.h"
+#include <bitset>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// More spilled runs than this are first merged into longer runs, which bounds the
+// number of spill files open at once
+const size_t MAX_FAN_IN = 64;
+// A budget must leave room to sort at least this many records at a time
+const size_t MIN_RUN_RECORDS = 1024;
+// Write buffer of the output file
+const size_t OUTPUT_BUFFER = 1 << 16;
+
+// Sequential reader of one sorted run, through a buffer of whole records
+class RunReader {
+private:
+    FILE* file;
+    vector<StateId> buffer;
+    size_t pos;
+    size_t len;
+    uint64_t& bytesRead;
+
+public:
+    RunReader(FILE* run, size_t bufferWords, uint64_t& bytesRead)
+        : file(run), buffer(bufferWords), pos(0), len(0), bytesRead(bytesRead) {
+        rewind(file);
+    }
+
+    // The next record of `words` StateIds, nullptr at the end of the run
+    const StateId* next(size_t words) {
+        if (pos == len) {
+            len = fread(buffer.data(), sizeof(StateId), buffer.size(), file);
+            bytesRead += len * sizeof(StateId);
+            pos = 0;
+            if (len < words) return nullptr;
+        }
+        const StateId* record = &buffer[pos];
+        pos += words;
+        return record;
+    }
+};
+
+class ExternalRefiner {
+private:
+    const MappedAutomaton& input;
+    const StateId* table;
+    const StateId n;
+    const size_t k;
+    const size_t words;          // Record length: block, k successor blocks, state
+    const uint64_t budget;
+    ExternalStats& stats;
+    // Block of every state, named by its lowest state; NO_STATE if unreachable. Entry n
+    // is the implicit sink that undefined transitions go to (NO_STATE if there are none).
+    vector<StateId> block;
+    uint64_t numBlocks;
+    vector<FILE*> runs;          // Spilled runs of the current round
+
+    void noteResident(uint64_t extra) {
+        stats.residentBytes = max(stats.residentBytes, vectorBytes(block) + extra);
+    }
+    // Signatures are compared as raw bytes, which is a total order; ties between equal
+    // signatures go to the lower state, so each group starts with its lowest state
+    bool recordLess(const StateId* a, const StateId* b) const {
+        int order = memcmp(a, b, (words - 1) * sizeof(StateId));
+        return order != 0 ? order < 0 : a[words - 1] < b[words - 1];
+    }
+    void signature(StateId s, StateId* record) const;
+    bool spill(const vector<StateId>& records, const vector<uint32_t>& order, string& error);
+    template <typename Consume>
+    bool merge(vector<FILE*> group, uint64_t bufferBytes, Consume consume, string& error);
+
+public:
+    ExternalRefiner(const MappedAutomaton& automaton, uint64_t memoryBudget, ExternalStats& stats)
+        : input(automaton), table(automaton.getTransitionTable()), n(automaton.getNumStates()),
+          k(automaton.getNumColumns()), words(automaton.getNumColumns() + 2), budget(memoryBudget),
+          stats(stats), numBlocks(0) {}
+    ~ExternalRefiner() {
+        for (FILE* run : runs) fclose(run);
+    }
+
+    // Smallest budget that covers the block IDs plus the largest phase on top of them
+    uint64_t requiredBytes() const;
+    bool findReachable(string& error);
+    // One round of refinement; sets `grew` if it split any block
+    bool refineRound(bool& grew, string& error);
+    bool writeOutput(const string& path, string& error);
+};
+
+uint64_t ExternalRefiner::requiredBytes() const {
+    const uint64_t positions = (uint64_t)n + 1;
+    const uint64_t bitsetBytes = (positions + 63) / 64 * sizeof(uint64_t);
+    uint64_t search = bitsetBytes;
+    uint64_t round = MIN_RUN_RECORDS * (words * sizeof(StateId) + sizeof(uint32_t));
+    // Representative bitset and ranks, accepting and dead bits of the output, write buffer
+    uint64_t output = bitsetBytes + bitsetBytes / 2 + 2 * bitsetBytes + OUTPUT_BUFFER + k * sizeof(StateId);
+    return positions * sizeof(StateId) + max(search, max(round, output));
+}
+
+bool ExternalRefiner::findReachable(string& error) {
+    STATS_PHASE("external_reachability");
+    // Breadth-first search that uses the block array as its queue
+    vector<uint64_t> seen(((size_t)n + 64) / 64, 0);
+    block.assign((size_t)n + 1, NO_STATE);
+    noteResident(vectorBytes(seen));
+    auto isSeen = [&](StateId s) { return (seen[s >> 6] >> (s & 63)) & 1; };
+
+    StateId* queue = block.data();
+    size_t head = 0, tail = 0;
+    bool hasSink = false;
+    const StateId start = input.getStartState();
+    seen[start >> 6] |= (uint64_t)1 << (start & 63);
+    queue[tail++] = start;
+    while (head < tail) {
+        const StateId* row = table + (size_t)queue[head++] * k;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = row[col];
+            if (dest == NO_STATE) {
+                hasSink = true;
+            } else if (dest >= n) {
+                error = "a transition targets state " + to_string(dest) + " out of range";
+                return false;
+            } else if (!isSeen(dest)) {
+                seen[dest >> 6] |= (uint64_t)1 << (dest & 63);
+                queue[tail++] = dest;
+            }
+        }
+    }
+    stats.reachableStates = (StateId)tail;
+    stats.tablePasses++;
+    stats.bytesRead += (uint64_t)tail * k * sizeof(StateId);
+
+    // Initial partition: reachable accepting vs. reachable non-accepting states, the
+    // implicit sink among the latter
+    StateId acceptRep = NO_STATE, rejectRep = NO_STATE;
+    for (StateId s = 0; s < n; ++s) {
+        if (!isSeen(s)) continue;
+        StateId& rep = input.isAccepting(s) ? acceptRep : rejectRep;
+        if (rep == NO_STATE) rep = s;
+    }
+    if (hasSink && rejectRep == NO_STATE) rejectRep = n;
+    for (StateId s = 0; s < n; ++s) {
+        block[s] = !isSeen(s) ? NO_STATE : input.isAccepting(s) ? acceptRep : rejectRep;
+    }
+    block[n] = hasSink ? rejectRep : NO_STATE;
+    numBlocks = (acceptRep != NO_STATE) + (rejectRep != NO_STATE);
+    return true;
+}
+
+void ExternalRefiner::signature(StateId s, StateId* record) const {
+    const StateId sinkBlock = block[n];
+    record[0] = block[s];
+    if (s == n) {
+        fill(record + 1, record + 1 + k, sinkBlock);
+    } else {
+        const StateId* row = table + (size_t)s * k;
+        for (size_t col = 0; col < k; ++col) {
+            record[1 + col] = row[col] == NO_STATE ? sinkBlock : block[row[col]];
+        }
+    }
+    record[words - 1] = s;
+}
+
+bool ExternalRefiner::spill(const vector<StateId>& records, const vector<uint32_t>& order, string& error) {
+    FILE* run = tmpfile();
+    if (!run) {
+        error = "cannot create a spill file";
+        return false;
+    }
+    runs.push_back(run);
+    for (uint32_t i : order) {
+        if (fwrite(&records[(size_t)i * words], sizeof(StateId), words, run) != words) {
+            error = "writing a spill file failed";
+            return false;
+        }
+    }
+    stats.runsSpilled++;
+    stats.bytesWritten += (uint64_t)order.size() * words * sizeof(StateId);
+    return true;
+}
+
+template <typename Consume>
+bool ExternalRefiner::merge(vector<FILE*> group, uint64_t bufferBytes, Consume consume, string& error) {
+    // Each run gets an equal share of the budget to read through
+    size_t recordsPerRun = max<uint64_t>(1, bufferBytes / group.size() / (words * sizeof(StateId)));
+    vector<RunReader> readers;
+    readers.reserve(group.size());
+    for (FILE* run : group) readers.emplace_back(run, recordsPerRun * words, stats.bytesRead);
+    noteResident((uint64_t)group.size() * recordsPerRun * words * sizeof(StateId));
+
+    vector<const StateId*> current(group.size());
+    auto after = [&](size_t a, size_t b) { return recordLess(current[b], current[a]); };
+    priority_queue<size_t, vector<size_t>, decltype(after)> heap(after);
+    for (size_t i = 0; i < readers.size(); ++i) {
+        current[i] = readers[i].next(words);
+        if (current[i]) heap.push(i);
+    }
+    bool ok = true;
+    while (!heap.empty() && ok) {
+        size_t i = heap.top();
+        heap.pop();
+        ok = consume(current[i]);
+        current[i] = readers[i].next(words);
+        if (current[i]) heap.push(i);
+    }
+    for (FILE* run : group) fclose(run);
+    if (!ok) error = "writing a spill file failed";
+    return ok;
+}
+
+bool ExternalRefiner::refineRound(bool& grew, string& error) {
+    STATS_PHASE("external_round");
+    const uint64_t recordBytes = words * sizeof(StateId) + sizeof(uint32_t);
+    const uint64_t available = budget - vectorBytes(block);
+    const uint64_t states = (uint64_t)stats.reachableStates + 2;
+    const size_t capacity = (size_t)min<uint64_t>(min<uint64_t>(available / recordBytes, states), UINT32_MAX);
+
+    // -------------------------------
+    // 1. SIGNATURES: one pass over the table, sorted in runs that fill the budget
+    // -------------------------------
+    vector<StateId> records(capacity * words);
+    vector<uint32_t> order;
+    order.reserve(capacity);
+    noteResident(vectorBytes(records) + vectorBytes(order));
+    auto indexLess = [&](uint32_t a, uint32_t b) {
+        return recordLess(&records[(size_t)a * words], &records[(size_t)b * words]);
+    };
+    for (StateId s = 0; s <= n; ++s) {
+        if (block[s] == NO_STATE) continue;
+        signature(s, &records[order.size() * words]);
+        order.push_back((uint32_t)order.size());
+        if (order.size() == capacity) {
+            sort(order.begin(), order.end(), indexLess);
+            if (!spill(records, order, error)) return false;
+            order.clear();
+        }
+    }
+    stats.tablePasses++;
+    stats.bytesRead += (uint64_t)stats.reachableStates * k * sizeof(StateId);
+
+    // -------------------------------
+    // 2. NEW BLOCKS: equal signatures in sorted order form a block named by its first state
+    // -------------------------------
+    vector<StateId> previous(words - 1);
+    uint64_t groups = 0;
+    StateId rep = NO_STATE;
+    auto assign = [&](const StateId* record) {
+        if (groups == 0 || memcmp(record, previous.data(), (words - 1) * sizeof(StateId)) != 0) {
+            memcpy(previous.data(), record, (words - 1) * sizeof(StateId));
+            rep = record[words - 1];
+            ++groups;
+        }
+        block[record[words - 1]] = rep;
+        return true;
+    };
+
+    if (runs.empty()) {
+        // Everything fit in one run: no spill file at all
+        sort(order.begin(), order.end(), indexLess);
+        for (uint32_t i : order) assign(&records[(size_t)i * words]);
+    } else {
+        if (!order.empty()) {
+            sort(order.begin(), order.end(), indexLess);
+            if (!spill(records, order, error)) return false;
+        }
+        vector<StateId>().swap(records);
+        vector<uint32_t>().swap(order);
+
+        // Too many runs to read at once are merged into longer runs first
+        while (runs.size() > MAX_FAN_IN) {
+            vector<FILE*> group(runs.begin(), runs.begin() + MAX_FAN_IN);
+            runs.erase(runs.begin(), runs.begin() + MAX_FAN_IN);
+            FILE* merged = tmpfile();
+            if (!merged) {
+                for (FILE* run : group) fclose(run);
+                error = "cannot create a spill file";
+                return false;
+            }
+            runs.push_back(merged);
+            auto write = [&](const StateId* record) {
+                stats.bytesWritten += words * sizeof(StateId);
+                return fwrite(record, sizeof(StateId), words, merged) == words;
+            };
+            if (!merge(move(group), available, write, error)) return false;
+            stats.mergePasses++;
+        }
+        vector<FILE*> group;
+        group.swap(runs);
+        if (!merge(move(group), available, assign, error)) return false;
+    }
+    grew = groups > numBlocks;
+    numBlocks = groups;
+    stats.rounds++;
+    STATS_PEAK("external_blocks", groups);
+    return true;
+}
+
+bool ExternalRefiner::writeOutput(const string& path, string& error) {
+    STATS_PHASE("external_output");
+    // Blocks are numbered like buildQuotient(): the start block is Q0 and the others
+    // follow in order of their lowest state, found by ranking the representatives
+    const size_t bitsetWords = ((size_t)n + 64) / 64;
+    vector<uint64_t> reps(bitsetWords, 0);
+    vector<StateId> rankBefore(bitsetWords, 0);
+    for (StateId s = 0; s <= n; ++s) {
+        if (block[s] == s) reps[s >> 6] |= (uint64_t)1 << (s & 63);
+    }
+    StateId m = 0;
+    for (size_t w = 0; w < bitsetWords; ++w) {
+        rankBefore[w] = m;
+        m += (StateId)bitset<64>(reps[w]).count();
+    }
+    const StateId startRep = block[input.getStartState()];
+    auto newState = [&](StateId rep) {
+        uint64_t below = reps[rep >> 6] & (((uint64_t)1 << (rep & 63)) - 1);
+        StateId rank = rankBefore[rep >> 6] + (StateId)bitset<64>(below).count();
+        return rep == startRep ? 0 : rep < startRep ? rank + 1 : rank;
+    };
+
+    BinaryHeader header = makeBinaryHeader(m, k, 0);
+    const BinaryHeader& inputHeader = input.getHeader();
+    memcpy(header.symbolToColumn, inputHeader.symbolToColumn, sizeof(header.symbolToColumn));
+    header.flags = BINARY_FLAG_MINIMIZED_NAMES;
+    vector<uint64_t> accepting(((size_t)m + 63) / 64, 0);
+    vector<uint64_t> dead(accepting.size(), 0);
+    for (StateId s = 0; s < n; ++s) {
+        if (block[s] == s && input.isAccepting(s)) {
+            StateId id = newState(s);
+            accepting[id >> 6] |= (uint64_t)1 << (id & 63);
+        }
+    }
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "cannot create '" + path + "'";
+        return false;
+    }
+    vector<char> buffer(OUTPUT_BUFFER);
+    setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+    vector<StateId> row(k);
+    noteResident(vectorBytes(reps) + vectorBytes(rankBefore) + vectorBytes(accepting) + vectorBytes(dead) +
+                 vectorBytes(buffer) + vectorBytes(row));
+
+    static const char padding[64] = {0};
+    uint64_t paddingBytes = header.transitionsOffset - header.deadOffset - dead.size() * sizeof(uint64_t);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+        && fwrite(accepting.data(), sizeof(uint64_t), accepting.size(), out) == accepting.size()
+        && fwrite(dead.data(), sizeof(uint64_t), dead.size(), out) == dead.size()
+        && fwrite(padding, 1, paddingBytes, out) == paddingBytes;
+
+    // Rows of the representatives, start block first; a block is dead if it rejects and
+    // only loops to itself
+    auto writeRow = [&](StateId rep) {
+        const StateId id = newState(rep);
+        bool loops = true;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = rep == n ? n : table[(size_t)rep * k + col];
+            row[col] = newState(block[dest == NO_STATE ? n : dest]);
+            loops = loops && row[col] == id;
+        }
+        if (loops && (rep == n || !input.isAccepting(rep))) dead[id >> 6] |= (uint64_t)1 << (id & 63);
+        return fwrite(row.data(), sizeof(StateId), k, out) == k;
+    };
+    ok = ok && writeRow(startRep);
+    for (StateId s = 0; s <= n && ok; ++s) {
+        if (block[s] == s && s != startRep) ok = writeRow(s);
+    }
+    ok = ok && fseek(out, (long)header.deadOffset, SEEK_SET) == 0
+        && fwrite(dead.data(), sizeof(uint64_t), dead.size(), out) == dead.size();
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        error = "write to '" + path + "' failed";
+        return false;
+    }
+    stats.minimalStates = m;
+    stats.tablePasses++;
+    stats.bytesRead += (uint64_t)m * k * sizeof(StateId);
+    stats.bytesWritten += header.fileSize;
+    return true;
+}
+
+}
+
+bool minimizeExternal(const string& inputPath, const string& outputPath, uint64_t memoryBudget,
+                      ExternalStats& stats, string& error) {
+    STATS_PHASE("minimize_external");
+    stats = ExternalStats();
+    MappedAutomaton input;
+    if (!input.open(inputPath, error)) return false;
+    stats.states = input.getNumStates();
+
+    ExternalRefiner refiner(input, memoryBudget, stats);
+    stats.requiredBytes = refiner.requiredBytes();
+    if (memoryBudget < stats.requiredBytes) {
+        error = "a memory budget of " + to_string(memoryBudget) + " bytes is too small for " +
+                to_string(stats.states) + " states; at least " + to_string(stats.requiredBytes) +
+                " bytes are needed";
+        return false;
+    }
+    if (!refiner.findReachable(error)) return false;
+    bool grew = true;
+    while (grew) {
+        if (!refiner.refineRound(grew, error)) return false;
+    }
+    if (!refiner.writeOutput(outputPath, error)) return false;
+
+    STATS_ADD("external_rounds", stats.rounds);
+    STATS_ADD("external_runs", stats.runsSpilled);
+    STATS_ADD("external_bytes_read", stats.bytesRead);
+    STATS_ADD("external_bytes_written", stats.bytesWritten);
+    STATS_PEAK("external_resident_bytes", stats.residentBytes);
+    return true;
+}
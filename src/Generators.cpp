@@ -0,0 +1,258 @@
+#include "Generators.h"
+#include <random>
+#include <bitset>
+
+using namespace std;
+
+string generatorAlphabet(size_t numSymbols) {
+    string symbols;
+    for (char c = 'a'; c <= 'z'; ++c) symbols.push_back(c);
+    for (char c = 'A'; c <= 'Z'; ++c) symbols.push_back(c);
+    for (char c = '0'; c <= '9'; ++c) symbols.push_back(c);
+    for (int c = 0; c < 256; ++c) {
+        if (symbols.find((char)c) == string::npos) symbols.push_back((char)c);
+    }
+    symbols.resize(min<size_t>(max<size_t>(numSymbols, 1), 256));
+    return symbols;
+}
+
+// Start an automaton over the first numSymbols generator symbols with no transitions
+static Automaton newGenerated(StateId numStates, size_t numSymbols, string& symbols) {
+    symbols = generatorAlphabet(numSymbols);
+    Automaton automaton;
+    automaton.setAlphabet(symbols);
+    automaton.initStates(numStates);
+    return automaton;
+}
+
+Automaton generateRandomDFA(StateId numStates, size_t numSymbols, uint64_t seed) {
+    string symbols;
+    Automaton automaton = newGenerated(numStates, numSymbols, symbols);
+    mt19937_64 rng(seed);
+    for (StateId s = 0; s < numStates; ++s) {
+        automaton.setAccepting(s, rng() & 1);
+        for (size_t col = 0; col < symbols.size(); ++col) {
+            automaton.setTransition(s, col, (StateId)(rng() % numStates));
+        }
+    }
+    return automaton;
+}
+
+Automaton generateChainDFA(StateId numStates, size_t numSymbols) {
+    string symbols;
+    Automaton automaton = newGenerated(numStates, numSymbols, symbols);
+    int step = automaton.getColumn(symbols[0]);
+    for (StateId s = 0; s < numStates; ++s) {
+        for (size_t col = 0; col < symbols.size(); ++col) automaton.setTransition(s, col, s);
+        if (s + 1 < numStates) automaton.setTransition(s, step, s + 1);
+    }
+    automaton.setAccepting(numStates - 1, true);
+    return automaton;
+}
+
+Automaton generateCombDFA(StateId numStates, size_t numSymbols) {
+    string symbols;
+    StateId spine = max<StateId>(1, numStates / 2);
+    Automaton automaton = newGenerated(spine * 2, max<size_t>(numSymbols, 2), symbols);
+    int along = automaton.getColumn(symbols[0]);
+    int down = automaton.getColumn(symbols[1]);
+    for (StateId s = 0; s < spine; ++s) {
+        StateId tooth = spine + s;
+        for (size_t col = 0; col < symbols.size(); ++col) {
+            automaton.setTransition(s, col, s);
+            automaton.setTransition(tooth, col, tooth);
+        }
+        automaton.setTransition(s, along, s + 1 < spine ? s + 1 : s);
+        automaton.setTransition(s, down, tooth);
+        // Thue-Morse: parity of the number of set bits
+        automaton.setAccepting(tooth, bitset<32>(s).count() & 1);
+    }
+    return automaton;
+}
+
+Automaton generateDeBruijnDFA(StateId numStates, size_t numSymbols) {
+    int order = 1;
+    while (((StateId)2 << order) <= numStates) ++order;
+    StateId cycle = (StateId)1 << order;
+
+    // Binary de Bruijn sequence B(2, order) by the prefer-one construction: start with
+    // `order` zeros and append a 1 whenever that gives an unseen window, else a 0
+    StateId mask = cycle - 1;
+    vector<bool> seen(cycle, false);
+    vector<int> sequence(order, 0);
+    StateId window = 0;
+    seen[0] = true;
+    while (true) {
+        StateId one = ((window << 1) | 1) & mask;
+        StateId zero = (window << 1) & mask;
+        if (!seen[one]) {
+            window = one;
+            sequence.push_back(1);
+        } else if (!seen[zero]) {
+            window = zero;
+            sequence.push_back(0);
+        } else {
+            break;
+        }
+        seen[window] = true;
+    }
+
+    string symbols;
+    Automaton automaton = newGenerated(cycle, numSymbols, symbols);
+    int step = automaton.getColumn(symbols[0]);
+    for (StateId s = 0; s < cycle; ++s) {
+        for (size_t col = 0; col < symbols.size(); ++col) automaton.setTransition(s, col, s);
+        automaton.setTransition(s, step, (s + 1) % cycle);
+        automaton.setAccepting(s, sequence[s] == 1);
+    }
+    return automaton;
+}
+
+Automaton generateUnreachableDFA(StateId numStates, StateId reachableStates, size_t numSymbols, uint64_t seed) {
+    string symbols;
+    Automaton automaton = newGenerated(numStates, numSymbols, symbols);
+    reachableStates = max<StateId>(1, min(reachableStates, numStates));
+    mt19937_64 rng(seed);
+    for (StateId s = 0; s < numStates; ++s) {
+        automaton.setAccepting(s, rng() & 1);
+        StateId range = s < reachableStates ? reachableStates : numStates;
+        for (size_t col = 0; col < symbols.size(); ++col) {
+            automaton.setTransition(s, col, (StateId)(rng() % range));
+        }
+    }
+    return automaton;
+}
+
+Automaton generateDeadEndDFA(StateId numStates, StateId liveStates, size_t numSymbols, uint64_t seed) {
+    string symbols;
+    Automaton automaton = newGenerated(numStates, numSymbols, symbols);
+    liveStates = max<StateId>(1, min(liveStates, numStates));
+    mt19937_64 rng(seed);
+    for (StateId s = 0; s < numStates; ++s) {
+        automaton.setAccepting(s, s < liveStates && (rng() & 1));
+        for (size_t col = 0; col < symbols.size(); ++col) {
+            StateId range = s < liveStates && col == 0 ? liveStates : numStates;
+            StateId dest = (StateId)(rng() % range);
+            if (s >= liveStates) dest = liveStates + dest % (numStates - liveStates);
+            automaton.setTransition(s, col, dest);
+        }
+    }
+    return automaton;
+}
+
+Automaton generateTrieDFA(StateId numStates, size_t numSymbols, uint64_t seed) {
+    string symbols;
+    numStates = max<StateId>(numStates, 2);
+    Automaton automaton = newGenerated(numStates, numSymbols, symbols);
+    const size_t k = symbols.size();
+    const StateId sink = numStates - 1;
+    mt19937_64 rng(seed);
+    for (StateId s = 0; s < numStates; ++s) {
+        for (size_t col = 0; col < k; ++col) automaton.setTransition(s, col, sink);
+    }
+
+    // Attach each node to a random free (state, symbol) slot of the nodes placed so far
+    vector<bool> isLeaf(sink, true);
+    vector<pair<StateId, size_t>> freeSlots;
+    for (size_t col = 0; col < k; ++col) freeSlots.push_back(make_pair(0, col));
+    for (StateId s = 1; s < sink; ++s) {
+        size_t pick = rng() % freeSlots.size();
+        pair<StateId, size_t> slot = freeSlots[pick];
+        freeSlots[pick] = freeSlots.back();
+        freeSlots.pop_back();
+        automaton.setTransition(slot.first, slot.second, s);
+        isLeaf[slot.first] = false;
+        for (size_t col = 0; col < k; ++col) freeSlots.push_back(make_pair(s, col));
+    }
+    for (StateId s = 0; s < sink; ++s) {
+        automaton.setAccepting(s, isLeaf[s] || rng() % 4 == 0);
+    }
+    return automaton;
+}
+
+Automaton generateSparseDFA(StateId numStates, size_t numSymbols, size_t defined, uint64_t seed) {
+    string symbols;
+    Automaton automaton = newGenerated(numStates, numSymbols, symbols);
+    const size_t k = symbols.size();
+    mt19937_64 rng(seed);
+    for (StateId s = 0; s < numStates; ++s) {
+        automaton.setAccepting(s, rng() % 4 == 0);
+        for (size_t i = 0; i < defined; ++i) {
+            automaton.setTransition(s, rng() % k, (StateId)(rng() % numStates));
+        }
+    }
+    return automaton;
+}
+
+Automaton generateRedundantDFA(StateId baseStates, StateId copies, size_t numSymbols, uint64_t seed) {
+    string symbols;
+    Automaton automaton = newGenerated(baseStates * copies, numSymbols, symbols);
+    const size_t k = symbols.size();
+    mt19937_64 rng(seed);
+    vector<StateId> base((size_t)baseStates * k);
+    vector<bool> accepting(baseStates);
+    for (StateId& dest : base) dest = (StateId)(rng() % baseStates);
+    for (StateId s = 0; s < baseStates; ++s) accepting[s] = rng() & 1;
+
+    // State s is copy s / baseStates of base state s % baseStates
+    for (StateId s = 0; s < baseStates * copies; ++s) {
+        StateId original = s % baseStates;
+        automaton.setAccepting(s, accepting[original]);
+        for (size_t col = 0; col < k; ++col) {
+            StateId copy = (StateId)(rng() % copies);
+            automaton.setTransition(s, col, base[(size_t)original * k + col] + copy * baseStates);
+        }
+    }
+    return automaton;
+}
+
+Nfa generateKeywordNFA(StateId numStates, size_t numSymbols, uint64_t seed) {
+    const string symbols = generatorAlphabet(numSymbols);
+    const size_t k = symbols.size();
+    mt19937_64 rng(seed);
+    // Chains are laid out after the start state; stop before the next one would not fit
+    vector<size_t> lengths;
+    StateId used = 1;
+    while (true) {
+        size_t length = 3 + rng() % 8;
+        if (used + 1 + length > numStates) break;
+        lengths.push_back(length);
+        used += (StateId)(1 + length);
+    }
+    Nfa nfa;
+    nfa.reset(symbols, used);
+    nfa.addStartState(0);
+    vector<bool> any(256, false), one(256, false);
+    for (char symbol : symbols) any[(unsigned char)symbol] = true;
+    nfa.addTransition(0, any, 0);
+    StateId s = 1;
+    for (size_t length : lengths) {
+        nfa.addEpsilon(0, s);
+        for (size_t i = 0; i < length; ++i, ++s) {
+            unsigned char symbol = (unsigned char)symbols[rng() % k];
+            one[symbol] = true;
+            nfa.addTransition(s, one, s + 1);
+            one[symbol] = false;
+        }
+        nfa.setAccepting(s++, true);
+    }
+    nfa.finishMoves();
+    return nfa;
+}
+
+Nfa generateSuffixNFA(StateId numStates) {
+    const string symbols = generatorAlphabet(2);
+    numStates = max<StateId>(numStates, 2);
+    vector<bool> first(256, false), both(256, false);
+    first[(unsigned char)symbols[0]] = true;
+    both[(unsigned char)symbols[0]] = both[(unsigned char)symbols[1]] = true;
+    Nfa nfa;
+    nfa.reset(symbols, numStates);
+    nfa.addStartState(0);
+    nfa.addTransition(0, both, 0);
+    nfa.addTransition(0, first, 1);
+    for (StateId s = 1; s + 1 < numStates; ++s) nfa.addTransition(s, both, s + 1);
+    nfa.setAccepting(numStates - 1, true);
+    nfa.finishMoves();
+    return nfa;
+}
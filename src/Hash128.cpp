@@ -0,0 +1,98 @@
+#include "Hash128.h"
+#include <cstring>
+
+using namespace std;
+
+static const uint64_t C1 = 0x87C37B91114253D5ULL;
+static const uint64_t C2 = 0x4CF5AD432745937FULL;
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+string Hash128::toHex() const {
+    static const char HEX[] = "0123456789abcdef";
+    string text(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        text[15 - i] = HEX[(high >> (4 * i)) & 15];
+        text[31 - i] = HEX[(low >> (4 * i)) & 15];
+    }
+    return text;
+}
+
+Hasher128::Hasher128(uint64_t seed) : h1(seed), h2(seed), tailLength(0), length(0) {}
+
+void Hasher128::mixBlock(const unsigned char* block) {
+    uint64_t k1, k2;
+    memcpy(&k1, block, 8);
+    memcpy(&k2, block + 8, 8);
+    k1 *= C1;
+    k1 = rotl(k1, 31);
+    k1 *= C2;
+    h1 ^= k1;
+    h1 = rotl(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52DCE729;
+    k2 *= C2;
+    k2 = rotl(k2, 33);
+    k2 *= C1;
+    h2 ^= k2;
+    h2 = rotl(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495AB5;
+}
+
+void Hasher128::update(const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    length += size;
+    if (tailLength > 0) {
+        size_t take = min(size, sizeof(tail) - tailLength);
+        memcpy(tail + tailLength, bytes, take);
+        tailLength += take;
+        bytes += take;
+        size -= take;
+        if (tailLength < sizeof(tail)) return;
+        mixBlock(tail);
+        tailLength = 0;
+    }
+    for (; size >= 16; bytes += 16, size -= 16) mixBlock(bytes);
+    memcpy(tail, bytes, size);
+    tailLength = size;
+}
+
+Hash128 Hasher128::finish() const {
+    uint64_t a = h1, b = h2;
+    uint64_t k1 = 0, k2 = 0;
+    for (size_t i = tailLength; i > 8; --i) k2 = (k2 << 8) | tail[i - 1];
+    for (size_t i = min<size_t>(tailLength, 8); i > 0; --i) k1 = (k1 << 8) | tail[i - 1];
+    if (tailLength > 8) {
+        k2 *= C2;
+        k2 = rotl(k2, 33);
+        k2 *= C1;
+        b ^= k2;
+    }
+    if (tailLength > 0) {
+        k1 *= C1;
+        k1 = rotl(k1, 31);
+        k1 *= C2;
+        a ^= k1;
+    }
+    a ^= length;
+    b ^= length;
+    a += b;
+    b += a;
+    a = fmix(a);
+    b = fmix(b);
+    a += b;
+    b += a;
+    return Hash128{a, b};
+}
@@ -0,0 +1,481 @@
+#include "IncrementalMinimizer.h"
+#include "Partition.h"
+#include <algorithm>
+
+using namespace std;
+
+static uint64_t edgeKey(size_t column, StateId dest) {
+    return ((uint64_t)column << 32) | dest;
+}
+
+IncrementalMinimizer::IncrementalMinimizer(const Automaton& dfa)
+    : sinkState(NO_STATE), addedEdgeCount(0), epoch(0) {
+    Automaton minimal = dfa;
+    if (minimal.hasUnreachableStates()) minimal.removeUnreachableStates();
+    minimal.minimizeInPlace(scratch);
+    scratch.quotient = Automaton();   // Holds the unminimized copy, not needed again
+    minimal.expandAlphabet();
+
+    const vector<char>& alphabet = minimal.getAlphabet();
+    symbols.assign(alphabet.begin(), alphabet.end());
+    symbolToColumn.fill(-1);
+    for (size_t col = 0; col < symbols.size(); ++col) {
+        symbolToColumn[(unsigned char)symbols[col]] = (int)col;
+    }
+    numColumns = symbols.size();
+    numStates = minimal.getNumStates();
+    startState = minimal.getStartState();
+    transitions = minimal.getTransitionTable();
+    accepting.resize(numStates);
+    for (StateId s = 0; s < numStates; ++s) accepting[s] = minimal.isAccepting(s);
+    for (StateId s = 0; s < numStates; ++s) {
+        if (isSinkRow(s)) sinkState = s;
+    }
+    forward.assign(numStates, NO_STATE);
+    isDirty.assign(numStates, false);
+    affectedStamp.assign(numStates, 0);
+    localStamp.assign(numStates, 0);
+    localId.assign(numStates, 0);
+    rebuildInverse();
+}
+
+void IncrementalMinimizer::rebuildInverse() {
+    buildInverseTransitions(transitions, numStates, numColumns, invOffsets, invSources);
+    inverseStates = numStates;
+    addedEdges.clear();
+    addedEdgeCount = 0;
+}
+
+void IncrementalMinimizer::predecessors(StateId dest, size_t column, vector<StateId>& out) const {
+    const size_t k = numColumns;
+    if (dest < inverseStates) {
+        size_t key = column * inverseStates + dest;
+        for (size_t i = invOffsets[key]; i < invOffsets[key + 1]; ++i) {
+            StateId s = invSources[i];
+            if (isLive(s) && transitions[(size_t)s * k + column] == dest) out.push_back(s);
+        }
+    }
+    auto it = addedEdges.find(edgeKey(column, dest));
+    if (it == addedEdges.end()) return;
+    for (StateId s : it->second) {
+        if (isLive(s) && transitions[(size_t)s * k + column] == dest) out.push_back(s);
+    }
+}
+
+void IncrementalMinimizer::markDirty(StateId s) {
+    if (isDirty[s]) return;
+    isDirty[s] = true;
+    dirty.push_back(s);
+}
+
+void IncrementalMinimizer::writeTransition(StateId s, size_t column, StateId dest) {
+    StateId& cell = transitions[(size_t)s * numColumns + column];
+    if (cell == dest) return;
+    cell = dest;
+    addedEdges[edgeKey(column, dest)].push_back(s);
+    ++addedEdgeCount;
+}
+
+bool IncrementalMinimizer::isSinkRow(StateId s) const {
+    if (accepting[s]) return false;
+    for (size_t col = 0; col < numColumns; ++col) {
+        if (transitions[(size_t)s * numColumns + col] != s) return false;
+    }
+    return true;
+}
+
+StateId IncrementalMinimizer::ensureSink() {
+    if (sinkState != NO_STATE) return sinkState;
+    sinkState = numStates;
+    addState(false);
+    return sinkState;
+}
+
+StateId IncrementalMinimizer::resolve(StateId s) const {
+    while (forward[s] != NO_STATE) {
+        if (forward[s] == s) return NO_STATE;
+        s = forward[s];
+    }
+    return s;
+}
+
+bool IncrementalMinimizer::checkState(StateId& s, string& error) const {
+    if (s >= numStates) {
+        error = "state " + to_string(s) + " out of range";
+        return false;
+    }
+    StateId live = resolve(s);
+    if (live == NO_STATE) {
+        error = "state " + to_string(s) + " was removed";
+        return false;
+    }
+    s = live;
+    return true;
+}
+
+bool IncrementalMinimizer::checkSymbol(char symbol, size_t& column, string& error) const {
+    int col = symbolToColumn[(unsigned char)symbol];
+    if (col < 0) {
+        error = string("symbol '") + symbol + "' is not in the alphabet";
+        return false;
+    }
+    column = (size_t)col;
+    return true;
+}
+
+StateId IncrementalMinimizer::addState(bool isAccepting) {
+    StateId s = numStates++;
+    transitions.resize((size_t)numStates * numColumns, NO_STATE);
+    accepting.push_back(isAccepting);
+    forward.push_back(NO_STATE);
+    isDirty.push_back(false);
+    affectedStamp.push_back(0);
+    localStamp.push_back(0);
+    localId.push_back(0);
+    // The sink itself is created through here, with its row looping back to it
+    StateId sink = s == sinkState ? s : ensureSink();
+    for (size_t col = 0; col < numColumns; ++col) writeTransition(s, col, sink);
+    markDirty(s);
+    return s;
+}
+
+bool IncrementalMinimizer::removeState(StateId s, string& error) {
+    if (!checkState(s, error)) return false;
+    if (s == startState || s == sinkState) {
+        error = "cannot remove the " + string(s == startState ? "start" : "sink") + " state";
+        return false;
+    }
+    StateId sink = ensureSink();
+    vector<StateId> preds;
+    for (size_t col = 0; col < numColumns; ++col) {
+        preds.clear();
+        predecessors(s, col, preds);
+        for (StateId p : preds) {
+            writeTransition(p, col, sink);
+            markDirty(p);
+        }
+    }
+    forward[s] = s;
+    return true;
+}
+
+bool IncrementalMinimizer::setTransition(StateId s, char symbol, StateId dest, string& error) {
+    size_t col;
+    if (!checkState(s, error) || !checkState(dest, error) || !checkSymbol(symbol, col, error)) return false;
+    if (transitions[(size_t)s * numColumns + col] == dest) return true;
+    // An edited sink is an ordinary state now; deleted edges need a new sink
+    if (s == sinkState) sinkState = NO_STATE;
+    writeTransition(s, col, dest);
+    markDirty(s);
+    return true;
+}
+
+bool IncrementalMinimizer::removeTransition(StateId s, char symbol, string& error) {
+    size_t col;
+    if (!checkState(s, error) || !checkSymbol(symbol, col, error)) return false;
+    StateId sink = ensureSink();
+    if (transitions[(size_t)s * numColumns + col] == sink) return true;
+    writeTransition(s, col, sink);
+    markDirty(s);
+    return true;
+}
+
+bool IncrementalMinimizer::setAccepting(StateId s, bool isAccepting, string& error) {
+    if (!checkState(s, error)) return false;
+    if (accepting[s] == isAccepting) return true;
+    if (s == sinkState) sinkState = NO_STATE;
+    accepting[s] = isAccepting;
+    markDirty(s);
+    return true;
+}
+
+size_t IncrementalMinimizer::update() {
+    if (dirty.empty()) return 0;
+    const size_t k = numColumns;
+    if (++epoch == 0) {
+        fill(affectedStamp.begin(), affectedStamp.end(), 0);
+        fill(localStamp.begin(), localStamp.end(), 0);
+        epoch = 1;
+    }
+
+    // -------------------------------
+    // 1. AFFECTED STATES: everything that can reach a dirty state
+    // -------------------------------
+    vector<StateId> local;
+    for (StateId s : dirty) {
+        isDirty[s] = false;
+        if (!isLive(s) || affectedStamp[s] == epoch) continue;
+        affectedStamp[s] = epoch;
+        local.push_back(s);
+    }
+    dirty.clear();
+    vector<StateId> preds;
+    for (size_t i = 0; i < local.size(); ++i) {
+        for (size_t col = 0; col < k; ++col) {
+            preds.clear();
+            predecessors(local[i], col, preds);
+            for (StateId p : preds) {
+                if (affectedStamp[p] == epoch) continue;
+                affectedStamp[p] = epoch;
+                local.push_back(p);
+            }
+        }
+    }
+    const size_t numAffected = local.size();
+    for (size_t i = 0; i < numAffected; ++i) {
+        localStamp[local[i]] = epoch;
+        localId[local[i]] = (StateId)i;
+    }
+    auto affected = [&](StateId s) { return affectedStamp[s] == epoch; };
+
+    // -------------------------------
+    // 2. CANDIDATES: unaffected states that may now equal an affected one
+    // -------------------------------
+    // Unaffected states are pairwise distinct, so if a ~ u and a goes to an unaffected
+    // state t on some column, u goes to t itself. A candidate list is a superset of the
+    // unaffected states equivalent to a.
+    vector<vector<StateId>> candidates(numAffected);
+    vector<bool> resolved(numAffected, false);
+    vector<StateId> queue;
+    for (size_t i = 0; i < numAffected; ++i) {
+        StateId a = local[i];
+        const StateId* row = &transitions[(size_t)a * k];
+        size_t bestCol = k;
+        size_t bestCount = 0;
+        for (size_t col = 0; col < k; ++col) {
+            StateId t = row[col];
+            if (affected(t)) continue;
+            size_t count = t < inverseStates
+                ? invOffsets[col * inverseStates + t + 1] - invOffsets[col * inverseStates + t] : 0;
+            auto it = addedEdges.find(edgeKey(col, t));
+            if (it != addedEdges.end()) count += it->second.size();
+            if (bestCol == k || count < bestCount) {
+                bestCol = col;
+                bestCount = count;
+            }
+        }
+        if (bestCol == k) continue;
+
+        preds.clear();
+        predecessors(row[bestCol], bestCol, preds);
+        vector<StateId>& list = candidates[i];
+        for (StateId u : preds) {
+            if (affected(u) || accepting[u] != accepting[a]) continue;
+            const StateId* other = &transitions[(size_t)u * k];
+            bool match = true;
+            for (size_t col = 0; col < k && match; ++col) {
+                match = affected(row[col]) || other[col] == row[col];
+            }
+            if (match) list.push_back(u);
+        }
+        sort(list.begin(), list.end());
+        list.erase(unique(list.begin(), list.end()), list.end());
+        resolved[i] = true;
+        queue.push_back((StateId)i);
+    }
+
+    // States whose successors are all affected inherit candidates backwards: if a goes to
+    // a' on col, a candidate for a goes on col to a candidate for a'
+    for (size_t head = 0; head < queue.size(); ++head) {
+        StateId target = local[queue[head]];
+        for (size_t col = 0; col < k; ++col) {
+            preds.clear();
+            predecessors(target, col, preds);
+            for (StateId a : preds) {
+                StateId i = localId[a];
+                if (resolved[i]) continue;
+                resolved[i] = true;
+                vector<StateId>& list = candidates[i];
+                vector<StateId> uPreds;
+                for (StateId v : candidates[queue[head]]) predecessors(v, col, uPreds);
+                for (StateId u : uPreds) {
+                    if (!affected(u) && accepting[u] == accepting[a]) list.push_back(u);
+                }
+                sort(list.begin(), list.end());
+                list.erase(unique(list.begin(), list.end()), list.end());
+                queue.push_back(i);
+            }
+        }
+    }
+
+    // Whatever is left only reaches affected states; any unaffected state may match it
+    vector<StateId> allUnaffected[2];
+    bool haveAll = false;
+    for (size_t i = 0; i < numAffected; ++i) {
+        if (resolved[i]) continue;
+        if (!haveAll) {
+            for (StateId u = 0; u < numStates; ++u) {
+                if (isLive(u) && !affected(u)) allUnaffected[accepting[u] ? 1 : 0].push_back(u);
+            }
+            haveAll = true;
+        }
+        candidates[i] = allUnaffected[accepting[local[i]] ? 1 : 0];
+    }
+
+    for (const vector<StateId>& list : candidates) {
+        for (StateId u : list) {
+            if (localStamp[u] == epoch) continue;
+            localStamp[u] = epoch;
+            localId[u] = (StateId)local.size();
+            local.push_back(u);
+        }
+    }
+    candidates.clear();
+    const size_t numInner = local.size();
+
+    // -------------------------------
+    // 3. LOCAL REFINEMENT: other targets become self-looping singleton blocks
+    // -------------------------------
+    vector<StateId> localTable(numInner * k);
+    for (size_t i = 0; i < numInner; ++i) {
+        const StateId* row = &transitions[(size_t)local[i] * k];
+        for (size_t col = 0; col < k; ++col) {
+            StateId t = row[col];
+            if (localStamp[t] != epoch) {
+                localStamp[t] = epoch;
+                localId[t] = (StateId)local.size();
+                local.push_back(t);
+            }
+            localTable[i * k + col] = localId[t];
+        }
+    }
+    const StateId numLocal = (StateId)local.size();
+    localTable.resize((size_t)numLocal * k);
+    for (StateId i = (StateId)numInner; i < numLocal; ++i) {
+        for (size_t col = 0; col < k; ++col) localTable[(size_t)i * k + col] = i;
+    }
+
+    Partition& P = scratch.partition;
+    P.reset(numLocal);
+    scratch.splits.clear();
+    for (size_t i = 0; i < numInner; ++i) {
+        if (accepting[local[i]]) P.mark((StateId)i);
+    }
+    P.splitMarked(scratch.splits);
+    for (StateId i = (StateId)numInner; i < numLocal; ++i) {
+        P.mark(i);
+        P.splitMarked(scratch.splits);
+    }
+    buildInverseTransitions(localTable, numLocal, k, scratch.invOffsets, scratch.invSources);
+    refinePartition(scratch, k);
+
+    // -------------------------------
+    // 4. MERGING: an unaffected member (at most one per block) survives, else the lowest id
+    // -------------------------------
+    vector<StateId> survivor(P.blockCount(), NO_STATE);
+    for (size_t i = numAffected; i < numInner; ++i) survivor[P.blockOf((StateId)i)] = local[i];
+    for (size_t i = 0; i < numAffected; ++i) {
+        StateId& rep = survivor[P.blockOf((StateId)i)];
+        if (rep == NO_STATE || (affected(rep) && local[i] < rep)) rep = local[i];
+    }
+
+    size_t merged = 0;
+    for (size_t i = 0; i < numAffected; ++i) {
+        StateId a = local[i];
+        StateId rep = survivor[P.blockOf((StateId)i)];
+        if (rep == a) continue;
+        for (size_t col = 0; col < k; ++col) {
+            preds.clear();
+            predecessors(a, col, preds);
+            for (StateId p : preds) writeTransition(p, col, rep);
+        }
+        forward[a] = rep;
+        if (startState == a) startState = rep;
+        if (sinkState == a) sinkState = rep;
+        ++merged;
+    }
+    // The survivor of the sink's block has an empty language, so in the now minimal
+    // DFA it loops to itself; check rather than hand out a state that does not
+    if (sinkState != NO_STATE && !isSinkRow(sinkState)) sinkState = NO_STATE;
+
+    // Fold the added edges back into the CSR once they outgrow a fraction of it
+    if (addedEdgeCount > invSources.size() / 8 + 4096) rebuildInverse();
+    return merged;
+}
+
+StateId IncrementalMinimizer::numberReachable(vector<StateId>& newId) const {
+    const size_t k = numColumns;
+    vector<bool> reachable(numStates, false);
+    vector<StateId> stack(1, startState);
+    reachable[startState] = true;
+    while (!stack.empty()) {
+        StateId s = stack.back();
+        stack.pop_back();
+        for (size_t col = 0; col < k; ++col) {
+            StateId t = transitions[(size_t)s * k + col];
+            if (!reachable[t]) {
+                reachable[t] = true;
+                stack.push_back(t);
+            }
+        }
+    }
+
+    // Reachable states keep their relative order, with the start state first
+    newId.assign(numStates, NO_STATE);
+    newId[startState] = 0;
+    StateId count = 1;
+    for (StateId s = 0; s < numStates; ++s) {
+        if (reachable[s] && s != startState) newId[s] = count++;
+    }
+    return count;
+}
+
+vector<StateId> IncrementalMinimizer::compact() {
+    update();
+    const size_t k = numColumns;
+
+    vector<StateId> newId;
+    StateId count = numberReachable(newId);
+
+    vector<StateId> newTransitions((size_t)count * k);
+    vector<bool> newAccepting(count);
+    for (StateId s = 0; s < numStates; ++s) {
+        if (newId[s] == NO_STATE) continue;
+        newAccepting[newId[s]] = accepting[s];
+        for (size_t col = 0; col < k; ++col) {
+            newTransitions[(size_t)newId[s] * k + col] = newId[transitions[(size_t)s * k + col]];
+        }
+    }
+
+    // Old ids, including merged ones, map through the state they resolve to
+    vector<StateId> mapping(numStates);
+    for (StateId s = 0; s < numStates; ++s) {
+        StateId live = resolve(s);
+        mapping[s] = live == NO_STATE ? NO_STATE : newId[live];
+    }
+
+    transitions.swap(newTransitions);
+    accepting.swap(newAccepting);
+    startState = 0;
+    sinkState = sinkState != NO_STATE ? newId[sinkState] : NO_STATE;
+    numStates = count;
+    forward.assign(count, NO_STATE);
+    isDirty.assign(count, false);
+    affectedStamp.assign(count, 0);
+    localStamp.assign(count, 0);
+    localId.assign(count, 0);
+    epoch = 0;
+    rebuildInverse();
+    return mapping;
+}
+
+Automaton IncrementalMinimizer::toAutomaton() const {
+    const size_t k = numColumns;
+    vector<StateId> newId;
+    StateId count = numberReachable(newId);
+
+    Automaton automaton;
+    automaton.setAlphabet(symbols);
+    automaton.initStates(count);
+    for (StateId s = 0; s < numStates; ++s) {
+        StateId id = newId[s];
+        if (id == NO_STATE) continue;
+        automaton.setStateName(id, "Q" + to_string(id));
+        automaton.setAccepting(id, accepting[s]);
+        automaton.setDead(id, s == sinkState);
+        for (size_t col = 0; col < k; ++col) {
+            automaton.setTransition(id, col, newId[transitions[(size_t)s * k + col]]);
+        }
+    }
+    return automaton;
+}
@@ -0,0 +1,120 @@
+#include "Layout.h"
+#include "Stats.h"
+#include <algorithm>
+
+using namespace std;
+
+bool parseStateOrder(const string& name, StateOrder& order) {
+    if (name == "bfs") order = StateOrder::BreadthFirst;
+    else if (name == "dfs") order = StateOrder::DepthFirst;
+    else if (name == "profile") order = StateOrder::Profile;
+    else return false;
+    return true;
+}
+
+vector<uint64_t> profileStateVisits(const Automaton& dfa, const unsigned char* data, size_t length) {
+    STATS_PHASE("profile");
+    const StateId n = dfa.getNumStates();
+    vector<uint64_t> visits(n, 0);
+    if (n == 0) return visits;
+    const StateId start = dfa.getStartState();
+    StateId state = start;
+    ++visits[state];
+    for (size_t i = 0; i < length; ++i) {
+        int col = dfa.getColumn((char)data[i]);
+        StateId next = col < 0 ? NO_STATE : dfa.getTransition(state, (size_t)col);
+        state = next == NO_STATE || dfa.isDead(next) ? start : next;
+        ++visits[state];
+    }
+    STATS_ADD("profile_bytes", length);
+    return visits;
+}
+
+namespace {
+
+// Search from the start state, then every state it missed in its old order
+vector<StateId> searchOrder(const Automaton& dfa, bool depthFirst) {
+    const StateId n = dfa.getNumStates();
+    const size_t k = dfa.getNumColumns();
+    vector<StateId> order;
+    order.reserve(n);
+    vector<bool> numbered(n, false);
+    if (n == 0) return order;
+
+    const StateId start = dfa.getStartState();
+    numbered[start] = true;
+    order.push_back(start);
+    if (!depthFirst) {
+        for (size_t i = 0; i < order.size(); ++i) {
+            for (size_t col = 0; col < k; ++col) {
+                StateId dest = dfa.getTransition(order[i], col);
+                if (dest != NO_STATE && !numbered[dest]) {
+                    numbered[dest] = true;
+                    order.push_back(dest);
+                }
+            }
+        }
+    } else {
+        // Preorder with an explicit stack of (state, next column to follow)
+        vector<pair<StateId, size_t>> stack(1, make_pair(start, (size_t)0));
+        while (!stack.empty()) {
+            pair<StateId, size_t>& top = stack.back();
+            if (top.second == k) {
+                stack.pop_back();
+                continue;
+            }
+            StateId dest = dfa.getTransition(top.first, top.second++);
+            if (dest != NO_STATE && !numbered[dest]) {
+                numbered[dest] = true;
+                order.push_back(dest);
+                stack.push_back(make_pair(dest, (size_t)0));
+            }
+        }
+    }
+    for (StateId s = 0; s < n; ++s) {
+        if (!numbered[s]) order.push_back(s);
+    }
+    return order;
+}
+
+}
+
+vector<StateId> computeStateOrder(const Automaton& dfa, StateOrder order, const vector<uint64_t>& visits) {
+    STATS_PHASE("layout");
+    vector<StateId> result = searchOrder(dfa, order == StateOrder::DepthFirst);
+    if (order != StateOrder::Profile || visits.size() != dfa.getNumStates()) return result;
+
+    // Visited states from the hottest down (stable, so ties keep breadth-first order).
+    // Each one that is not placed yet starts a chain that keeps following its hottest
+    // unplaced successor, so the most likely next row is usually the adjacent one.
+    const size_t k = dfa.getNumColumns();
+    vector<StateId> hot;
+    for (StateId s : result) {
+        if (visits[s] > 0) hot.push_back(s);
+    }
+    stable_sort(hot.begin(), hot.end(), [&](StateId a, StateId b) { return visits[a] > visits[b]; });
+    vector<bool> placed(dfa.getNumStates(), false);
+    vector<StateId> profiled;
+    profiled.reserve(result.size());
+    for (StateId s : hot) {
+        while (s != NO_STATE && !placed[s]) {
+            placed[s] = true;
+            profiled.push_back(s);
+            StateId next = NO_STATE;
+            for (size_t col = 0; col < k; ++col) {
+                StateId dest = dfa.getTransition(s, col);
+                if (dest == NO_STATE || placed[dest] || visits[dest] == 0) continue;
+                if (next == NO_STATE || visits[dest] > visits[next]) next = dest;
+            }
+            s = next;
+        }
+    }
+    for (StateId s : result) {
+        if (!placed[s]) profiled.push_back(s);
+    }
+    return profiled;
+}
+
+void reorderStates(Automaton& dfa, StateOrder order, const vector<uint64_t>& visits) {
+    dfa.permuteStates(computeStateOrder(dfa, order, visits));
+}
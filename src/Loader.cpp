@@ -0,0 +1,440 @@
+#include "Loader.h"
+#include "Export.h"
+#include "Utils.h"
+#include "Stats.h"
+#include <new>
+
+using namespace std;
+
+Tokenizer::Tokenizer(FILE* stream, size_t bufferSize)
+    : file(stream), ownsFile(false), buffer(bufferSize), pos(0), len(0), line(1) {}
+
+Tokenizer::Tokenizer(const string& path, size_t bufferSize)
+    : file(nullptr), ownsFile(false), buffer(bufferSize), pos(0), len(0), line(1) {
+    if (path == "-") {
+        file = stdin;
+    } else {
+        file = fopen(path.c_str(), "rb");
+        ownsFile = true;
+    }
+}
+
+Tokenizer::~Tokenizer() {
+    if (ownsFile && file) fclose(file);
+}
+
+bool Tokenizer::refill() {
+    if (!file) return false;
+    len = fread(buffer.data(), 1, buffer.size(), file);
+    pos = 0;
+    return len > 0;
+}
+
+bool Tokenizer::skipSpace() {
+    while (true) {
+        int c = peek();
+        if (c < 0) return false;
+        if (c == '#') {
+            while ((c = peek()) >= 0 && c != '\n') ++pos;
+            continue;
+        }
+        if (c > ' ') return true;
+        if (c == '\n') ++line;
+        ++pos;
+    }
+}
+
+bool Tokenizer::readWord(string& word) {
+    word.clear();
+    if (!skipSpace()) return false;
+    int c;
+    while ((c = peek()) > ' ') {
+        word.push_back((char)c);
+        ++pos;
+    }
+    return true;
+}
+
+bool Tokenizer::readUnsigned(uint64_t& value) {
+    if (!skipSpace()) return false;
+    int c = peek();
+    if (c < '0' || c > '9') return false;
+    value = 0;
+    while ((c = peek()) >= '0' && c <= '9') {
+        // A number that does not fit is malformed, not silently wrapped
+        unsigned digit = (unsigned)(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+        ++pos;
+    }
+    return c < 0 || c <= ' ' || c == '#';
+}
+
+bool Tokenizer::readIndex(int64_t& value) {
+    if (!skipSpace()) return false;
+    if (peek() == '-') {
+        ++pos;
+        if (peek() != '1') return false;
+        ++pos;
+        int c = peek();
+        value = -1;
+        return c < 0 || c <= ' ' || c == '#';
+    }
+    uint64_t v;
+    if (!readUnsigned(v) || v > (uint64_t)INT64_MAX) return false;
+    value = (int64_t)v;
+    return true;
+}
+
+bool Tokenizer::readChar(char& c) {
+    if (!skipSpace()) return false;
+    c = (char)peek();
+    ++pos;
+    int next = peek();
+    return next < 0 || next <= ' ' || next == '#';
+}
+
+// Parse one symbol: a plain character, "\\" or "\xHH"
+static bool parseSymbol(const string& word, size_t& i, unsigned char& symbol) {
+    if (word[i] != '\\') {
+        symbol = (unsigned char)word[i++];
+        return true;
+    }
+    if (i + 1 < word.size() && word[i + 1] == '\\') {
+        symbol = '\\';
+        i += 2;
+        return true;
+    }
+    if (i + 3 >= word.size() || (word[i + 1] != 'x' && word[i + 1] != 'X')) return false;
+    int value = 0;
+    for (size_t j = i + 2; j < i + 4; ++j) {
+        char h = word[j];
+        int digit = h >= '0' && h <= '9' ? h - '0'
+                  : h >= 'a' && h <= 'f' ? h - 'a' + 10
+                  : h >= 'A' && h <= 'F' ? h - 'A' + 10 : -1;
+        if (digit < 0) return false;
+        value = value * 16 + digit;
+    }
+    symbol = (unsigned char)value;
+    i += 4;
+    return true;
+}
+
+// Parse a symbol set such as "ab", "\x00\x7F" or "[a-z0-9_]". A single character always
+// stands for itself, so "[" and "\" still work as one-symbol words.
+static bool parseSymbolSet(const string& word, vector<bool>& symbols) {
+    symbols.assign(256, false);
+    if (word.size() == 1) {
+        symbols[(unsigned char)word[0]] = true;
+        return true;
+    }
+    size_t i = 0;
+    while (i < word.size()) {
+        if (word[i] != '[') {
+            unsigned char symbol;
+            if (!parseSymbol(word, i, symbol)) return false;
+            symbols[symbol] = true;
+            continue;
+        }
+        ++i;
+        while (true) {
+            if (i >= word.size()) return false;
+            if (word[i] == ']') {
+                ++i;
+                break;
+            }
+            unsigned char low, high;
+            if (!parseSymbol(word, i, low)) return false;
+            high = low;
+            if (i + 1 < word.size() && word[i] == '-' && word[i + 1] != ']') {
+                ++i;
+                if (!parseSymbol(word, i, high) || high < low) return false;
+            }
+            for (int c = low; c <= high; ++c) symbols[c] = true;
+        }
+    }
+    return true;
+}
+
+// Read "<count> <state>..." and set the flag on every listed state
+static bool readStateList(Tokenizer& in, Automaton& automaton, bool dead,
+                          StateId numStates, size_t& badIndices, string& error) {
+    uint64_t count;
+    if (!in.readUnsigned(count)) {
+        error = "expected a state count on line " + to_string(in.lineNumber());
+        return false;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t s;
+        if (!in.readUnsigned(s)) {
+            error = "expected a state index on line " + to_string(in.lineNumber());
+            return false;
+        }
+        if (s >= numStates) {
+            ++badIndices;
+            continue;
+        }
+        if (dead)
+            automaton.setDead((StateId)s, true);
+        else
+            automaton.setAccepting((StateId)s, true);
+    }
+    return true;
+}
+
+// After a syntax error, skip to the record's 'end' so the next load starts at the next record
+static bool skipRecord(Tokenizer& in) {
+    string word;
+    while (in.readWord(word) && word != "end") {}
+    return false;
+}
+
+// Body of a dfa record, after its header
+static bool loadDfaBody(Tokenizer& in, const string& symbols, StateId numStates,
+                        Automaton& automaton, string& error) {
+    string word;
+    vector<bool> symbolSet;
+
+    // Replaces the previous contents but keeps the automaton's buffers
+    automaton.setAlphabet(symbols);
+    automaton.initStates(numStates);
+
+    // Problems are tallied here and reported once the whole record has been read
+    size_t badIndices = 0, badSymbols = 0, conflicts = 0;
+    size_t firstBadLine = 0;
+    StateId deadState = NO_STATE;
+
+    while (true) {
+        int c = in.peekToken();
+        if (c < 0) break;
+
+        if (c >= '0' && c <= '9') {
+            // Transition: <from> <symbols> <to>, applied to every symbol in the set
+            uint64_t from;
+            int64_t to;
+            if (!in.readUnsigned(from) || !in.readWord(word) || !parseSymbolSet(word, symbolSet)
+                || !in.readIndex(to)) {
+                error = "malformed transition on line " + to_string(in.lineNumber());
+                return skipRecord(in);
+            }
+            bool symbolsOk = true;
+            for (int c = 0; c < 256 && symbolsOk; ++c) {
+                symbolsOk = !symbolSet[c] || automaton.getColumn((char)c) >= 0;
+            }
+            bool fromOk = from < numStates;
+            bool toOk = to == -1 || (uint64_t)to < numStates;
+            if (!fromOk || !toOk || !symbolsOk) {
+                if (!fromOk || !toOk) ++badIndices;
+                if (!symbolsOk) ++badSymbols;
+                if (!firstBadLine) firstBadLine = in.lineNumber();
+                continue;
+            }
+
+            StateId dest;
+            if (to == -1) {
+                if (deadState == NO_STATE) deadState = automaton.ensureDeadState();
+                dest = deadState;
+            } else {
+                dest = (StateId)to;
+            }
+            for (int c = 0; c < 256; ++c) {
+                if (!symbolSet[c]) continue;
+                int col = automaton.getColumn((char)c);
+                StateId previous = automaton.getTransition((StateId)from, col);
+                if (previous != NO_STATE && previous != dest) {
+                    ++conflicts;
+                    if (!firstBadLine) firstBadLine = in.lineNumber();
+                }
+                automaton.setTransition((StateId)from, col, dest);
+            }
+            continue;
+        }
+
+        in.readWord(word);
+        if (word == "end") break;
+        if (word == "start") {
+            uint64_t s;
+            if (!in.readUnsigned(s)) {
+                error = "expected a state index after 'start' on line " + to_string(in.lineNumber());
+                return skipRecord(in);
+            }
+            if (s >= numStates) {
+                ++badIndices;
+                if (!firstBadLine) firstBadLine = in.lineNumber();
+                continue;
+            }
+            automaton.setStartState((StateId)s);
+        } else if (word == "accept" || word == "dead") {
+            size_t before = badIndices;
+            if (!readStateList(in, automaton, word == "dead", numStates, badIndices, error))
+                return skipRecord(in);
+            if (badIndices != before && !firstBadLine) firstBadLine = in.lineNumber();
+        } else {
+            error = "unknown keyword '" + word + "' on line " + to_string(in.lineNumber());
+            return skipRecord(in);
+        }
+    }
+
+    if (badIndices || badSymbols || conflicts) {
+        error = "invalid automaton (first problem near line " + to_string(firstBadLine) + "): ";
+        if (badIndices) error += to_string(badIndices) + " state index(es) out of range 0-" + to_string(numStates - 1) + "; ";
+        if (badSymbols) error += to_string(badSymbols) + " transition(s) on symbols outside the alphabet; ";
+        if (conflicts) error += to_string(conflicts) + " conflicting transition(s); ";
+        error.erase(error.size() - 2);
+        return false;
+    }
+    return true;
+}
+
+// Body of an nfa record, after its header. Mirrors loadDfaBody(), except that transitions
+// add destinations instead of replacing them and there is no dead sink.
+static bool loadNfaBody(Tokenizer& in, const string& symbols, StateId numStates, Nfa& nfa,
+                        string& error) {
+    string word;
+    vector<bool> symbolSet;
+    nfa.reset(symbols, numStates);
+    vector<bool> inAlphabet(256, false);
+    for (char symbol : symbols) inAlphabet[(unsigned char)symbol] = true;
+
+    size_t badIndices = 0, badSymbols = 0;
+    size_t firstBadLine = 0;
+    auto badIndex = [&]() {
+        ++badIndices;
+        if (!firstBadLine) firstBadLine = in.lineNumber();
+    };
+
+    while (true) {
+        int c = in.peekToken();
+        if (c < 0) break;
+
+        if (c >= '0' && c <= '9') {
+            // Transition: <from> <symbols> <to>; repeated lines add destinations
+            uint64_t from;
+            int64_t to;
+            if (!in.readUnsigned(from) || !in.readWord(word) || !parseSymbolSet(word, symbolSet)
+                || !in.readIndex(to)) {
+                error = "malformed transition on line " + to_string(in.lineNumber());
+                return skipRecord(in);
+            }
+            bool symbolsOk = true;
+            for (int c = 0; c < 256 && symbolsOk; ++c) symbolsOk = !symbolSet[c] || inAlphabet[c];
+            if (from >= numStates || to < 0 || (uint64_t)to >= numStates) {
+                badIndex();
+            } else if (!symbolsOk) {
+                ++badSymbols;
+                if (!firstBadLine) firstBadLine = in.lineNumber();
+            } else {
+                nfa.addTransition((StateId)from, symbolSet, (StateId)to);
+            }
+            continue;
+        }
+
+        in.readWord(word);
+        if (word == "end") break;
+        if (word == "start" || word == "eps") {
+            // start <state> adds a start state; eps <from> <to> adds an epsilon move
+            uint64_t from = 0, to;
+            if ((word == "eps" && !in.readUnsigned(from)) || !in.readUnsigned(to)) {
+                error = "expected a state index after '" + word + "' on line " + to_string(in.lineNumber());
+                return skipRecord(in);
+            }
+            if (from >= numStates || to >= numStates) {
+                badIndex();
+            } else if (word == "eps") {
+                nfa.addEpsilon((StateId)from, (StateId)to);
+            } else {
+                nfa.addStartState((StateId)to);
+            }
+        } else if (word == "accept") {
+            uint64_t count;
+            if (!in.readUnsigned(count)) {
+                error = "expected a state count on line " + to_string(in.lineNumber());
+                return skipRecord(in);
+            }
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t s;
+                if (!in.readUnsigned(s)) {
+                    error = "expected a state index on line " + to_string(in.lineNumber());
+                    return skipRecord(in);
+                }
+                if (s >= numStates)
+                    badIndex();
+                else
+                    nfa.setAccepting((StateId)s, true);
+            }
+        } else {
+            error = "unknown keyword '" + word + "' on line " + to_string(in.lineNumber());
+            return skipRecord(in);
+        }
+    }
+
+    if (badIndices || badSymbols) {
+        error = "invalid automaton (first problem near line " + to_string(firstBadLine) + "): ";
+        if (badIndices) error += to_string(badIndices) + " state index(es) out of range 0-" + to_string(numStates - 1) + "; ";
+        if (badSymbols) error += to_string(badSymbols) + " transition(s) on symbols outside the alphabet; ";
+        error.erase(error.size() - 2);
+        return false;
+    }
+    nfa.finishMoves();
+    return true;
+}
+
+bool loadRecord(Tokenizer& in, Automaton& automaton, Nfa& nfa, bool& isNfa, string& error) {
+    STATS_PHASE("load");
+    string word;
+    if (!in.readWord(word)) {
+        error = "unexpected end of input, expected 'dfa' header";
+        return false;
+    }
+    uint64_t count;
+    isNfa = word == "nfa";
+    if ((word != "dfa" && !isNfa) || !in.readUnsigned(count) || !in.readWord(word)) {
+        error = "expected 'dfa <numStates> <alphabet>' or 'nfa <numStates> <alphabet>' on line "
+              + to_string(in.lineNumber());
+        return word == "end" ? false : skipRecord(in);
+    }
+    vector<bool> symbolSet;
+    if (!parseSymbolSet(word, symbolSet)) {
+        error = "malformed alphabet '" + word + "' on line " + to_string(in.lineNumber());
+        return skipRecord(in);
+    }
+    string symbols;
+    for (int c = 0; c < 256; ++c) {
+        if (symbolSet[c]) symbols.push_back((char)c);
+    }
+    if (count < 1 || count >= NO_STATE) {
+        error = "state count out of range: " + to_string(count);
+        return skipRecord(in);
+    }
+    // The tables are sized by the header before any state is read, so a short record can
+    // ask for more memory than there is: refuse it like any other malformed record
+    try {
+        if (isNfa) return loadNfaBody(in, symbols, (StateId)count, nfa, error);
+        return loadDfaBody(in, symbols, (StateId)count, automaton, error);
+    } catch (const bad_alloc&) {
+        error = "not enough memory for " + to_string(count) + " states";
+        return skipRecord(in);
+    }
+}
+
+bool loadAutomaton(Tokenizer& in, Automaton& automaton, string& error) {
+    // NFA records are parsed into a per-thread buffer and determinized right away
+    static thread_local Nfa nfa;
+    bool isNfa;
+    if (!loadRecord(in, automaton, nfa, isNfa, error)) return false;
+    return !isNfa || nfa.determinize(automaton, error);
+}
+
+bool loadAutomatonFile(const string& path, Automaton& automaton, string& error) {
+    Tokenizer in(path);
+    if (!in.isOpen()) {
+        error = "cannot open '" + path + "'";
+        return false;
+    }
+    return loadAutomaton(in, automaton, error);
+}
+
+void formatAutomaton(const Automaton& automaton, string& out) {
+    OutputBuffer buffer(out);
+    exportAutomaton(automaton, ExportFormat::Text, buffer);
+}
@@ -0,0 +1,234 @@
+#include "Matcher.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+Matcher::Matcher() : stride(1), table(1, 0), startState(0), acceptBoundary(1), numStates(1) {
+    byteClass.fill(0);
+}
+
+bool Matcher::compile(const Automaton& dfa, Matcher& matcher, string& error) {
+    const StateId n = dfa.getNumStates();
+    const size_t k = dfa.getNumColumns();
+    const uint32_t stride = (uint32_t)k + 1;
+
+    // Non-accepting states that only loop to themselves behave exactly like the sink
+    vector<bool> isSink(n, false);
+    for (StateId s = 0; s < n; ++s) {
+        if (dfa.isAccepting(s)) continue;
+        bool loops = true;
+        for (size_t col = 0; col < k && loops; ++col) {
+            StateId dest = dfa.getTransition(s, col);
+            loops = dest == s || dest == NO_STATE;
+        }
+        isSink[s] = loops;
+    }
+
+    // Row 0 is the sink, then non-accepting states, then accepting states
+    vector<uint32_t> rowOf(n, 0);
+    uint32_t rows = 1;
+    for (StateId s = 0; s < n; ++s) {
+        if (!dfa.isAccepting(s) && !isSink[s]) rowOf[s] = rows++;
+    }
+    uint32_t firstAccepting = rows;
+    for (StateId s = 0; s < n; ++s) {
+        if (dfa.isAccepting(s)) rowOf[s] = rows++;
+    }
+    if ((uint64_t)rows * stride >= numeric_limits<uint32_t>::max()) {
+        error = "automaton too large to compile into a matcher: " + to_string(rows) + " states x "
+                + to_string(stride) + " columns";
+        return false;
+    }
+
+    // Column k collects every byte outside the alphabet
+    for (int b = 0; b < 256; ++b) {
+        int col = dfa.getColumn((char)b);
+        matcher.byteClass[b] = col < 0 ? (uint32_t)k : (uint32_t)col;
+    }
+    matcher.stride = stride;
+    matcher.numStates = rows;
+    matcher.acceptBoundary = firstAccepting * stride;
+    matcher.startState = n > 0 ? rowOf[dfa.getStartState()] * stride : 0;
+    vector<uint32_t>& table = matcher.table;
+    table.assign((size_t)rows * stride, 0);
+    for (StateId s = 0; s < n; ++s) {
+        if (rowOf[s] == 0) continue;
+        uint32_t* row = &table[(size_t)rowOf[s] * stride];
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = dfa.getTransition(s, col);
+            row[col] = dest == NO_STATE ? 0 : rowOf[dest] * stride;
+        }
+    }
+    return true;
+}
+
+uint32_t Matcher::feed(uint32_t state, const unsigned char* data, size_t length) const {
+    const uint32_t* t = table.data();
+    const uint32_t* cls = byteClass.data();
+    size_t i = 0;
+    // Unrolled: the class lookups are independent of the state chain and overlap with it
+    for (; i + 4 <= length; i += 4) {
+        state = t[state + cls[data[i]]];
+        state = t[state + cls[data[i + 1]]];
+        state = t[state + cls[data[i + 2]]];
+        state = t[state + cls[data[i + 3]]];
+    }
+    for (; i < length; ++i) state = t[state + cls[data[i]]];
+    return state;
+}
+
+bool Matcher::matches(const unsigned char* data, size_t length) const {
+    const size_t BLOCK = 4096;
+    uint32_t state = startState;
+    for (size_t i = 0; i < length; i += BLOCK) {
+        state = feed(state, data + i, min(BLOCK, length - i));
+        if (state == 0) return false; // Stuck in the sink
+    }
+    return isAccepting(state);
+}
+
+uint32_t Matcher::findAccepts(uint32_t state, const unsigned char* data, size_t length,
+                              uint64_t base, vector<uint64_t>& positions) const {
+    const uint32_t* t = table.data();
+    const uint32_t* cls = byteClass.data();
+    const uint32_t boundary = acceptBoundary;
+    for (size_t i = 0; i < length; ++i) {
+        state = t[state + cls[data[i]]];
+        if (state >= boundary) positions.push_back(base + i + 1);
+    }
+    return state;
+}
+
+ScanState Matcher::beginLines() const {
+    ScanState scan;
+    scan.state = startState;
+    scan.offset = 0;
+    scan.lineStart = 0;
+    return scan;
+}
+
+void Matcher::scanLines(ScanState& scan, const unsigned char* data, size_t length,
+                        vector<uint64_t>& lines) const {
+    const unsigned char* p = data;
+    const unsigned char* end = data + length;
+    const size_t firstNew = lines.size();
+
+    // 1. The line carried over from the previous buffer is finished on its own.
+    // memchr finds line ends far faster than testing every byte in the state loop.
+    const unsigned char* newline = (const unsigned char*)memchr(p, '\n', end - p);
+    if (scan.state != 0) scan.state = feed(scan.state, p, (newline ? newline : end) - p);
+    if (!newline) {
+        scan.offset += length;
+        return;
+    }
+    if (isAccepting(scan.state)) lines.push_back(scan.lineStart);
+    p = newline + 1;
+
+    // 2. Complete lines inside the buffer run several at a time in lockstep. A single
+    // line is bound by the latency of one table load per byte; independent lines
+    // overlap their loads. Each lane takes the next line when its own line ends.
+    const int LANES = 4;
+    const uint32_t* t = table.data();
+    const uint32_t* cls = byteClass.data();
+    const unsigned char* lanePos[LANES];
+    const unsigned char* laneEnd[LANES];
+    uint32_t laneState[LANES];
+    uint64_t laneStart[LANES];
+    bool laneActive[LANES];
+    auto takeLine = [&](int l) {
+        const unsigned char* nl = p < end ? (const unsigned char*)memchr(p, '\n', end - p) : nullptr;
+        laneActive[l] = nl != nullptr;
+        if (!nl) return;
+        lanePos[l] = p;
+        laneEnd[l] = nl;
+        laneState[l] = startState;
+        laneStart[l] = scan.offset + (p - data);
+        p = nl + 1;
+    };
+    for (int l = 0; l < LANES; ++l) takeLine(l);
+
+    while (true) {
+        // Retire lanes that reached their line end or fell into the sink
+        for (int l = 0; l < LANES; ++l) {
+            while (laneActive[l] && (lanePos[l] == laneEnd[l] || laneState[l] == 0)) {
+                if (lanePos[l] == laneEnd[l] && isAccepting(laneState[l])) lines.push_back(laneStart[l]);
+                takeLine(l);
+            }
+        }
+
+        // Every active lane can take `run` more bytes without reaching its end
+        size_t run = numeric_limits<size_t>::max();
+        int anyActive = -1;
+        for (int l = 0; l < LANES; ++l) {
+            if (!laneActive[l]) continue;
+            run = min(run, (size_t)(laneEnd[l] - lanePos[l]));
+            anyActive = l;
+        }
+        if (anyActive < 0) break;
+        // Idle lanes spin in the sink over an active lane's bytes
+        for (int l = 0; l < LANES; ++l) {
+            if (laneActive[l]) continue;
+            lanePos[l] = lanePos[anyActive];
+            laneState[l] = 0;
+        }
+
+        uint32_t s0 = laneState[0], s1 = laneState[1], s2 = laneState[2], s3 = laneState[3];
+        const unsigned char* p0 = lanePos[0];
+        const unsigned char* p1 = lanePos[1];
+        const unsigned char* p2 = lanePos[2];
+        const unsigned char* p3 = lanePos[3];
+        for (size_t i = 0; i < run; ++i) {
+            s0 = t[s0 + cls[p0[i]]];
+            s1 = t[s1 + cls[p1[i]]];
+            s2 = t[s2 + cls[p2[i]]];
+            s3 = t[s3 + cls[p3[i]]];
+        }
+        laneState[0] = s0; laneState[1] = s1; laneState[2] = s2; laneState[3] = s3;
+        for (int l = 0; l < LANES; ++l) {
+            if (laneActive[l]) lanePos[l] += run;
+        }
+    }
+    // Lanes finish out of order
+    sort(lines.begin() + firstNew, lines.end());
+
+    // 3. The unterminated tail is carried into the next buffer
+    scan.lineStart = scan.offset + (p - data);
+    scan.state = feed(startState, p, end - p);
+    scan.offset += length;
+}
+
+void Matcher::finishLines(ScanState& scan, vector<uint64_t>& lines) const {
+    if (scan.offset > scan.lineStart && isAccepting(scan.state)) lines.push_back(scan.lineStart);
+    scan.state = startState;
+    scan.lineStart = scan.offset;
+}
+
+bool Matcher::scanFileLines(const string& path, vector<uint64_t>& lines, string& error) const {
+    ScanState scan = beginLines();
+    if (path != "-") {
+        MappedFile file;
+        if (!file.open(path, error)) {
+            // Empty files cannot be mapped but simply contain no lines
+            FILE* probe = fopen(path.c_str(), "rb");
+            bool empty = probe && fgetc(probe) == EOF;
+            if (probe) fclose(probe);
+            return empty;
+        }
+        scanLines(scan, file.bytes(), file.size(), lines);
+    } else {
+        vector<unsigned char> buffer(1 << 20);
+        size_t got;
+        while ((got = fread(buffer.data(), 1, buffer.size(), stdin)) > 0) {
+            scanLines(scan, buffer.data(), got, lines);
+        }
+        if (ferror(stdin)) {
+            error = "read error on stdin";
+            return false;
+        }
+    }
+    finishLines(scan, lines);
+    return true;
+}
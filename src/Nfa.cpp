@@ -0,0 +1,349 @@
+#include "Nfa.h"
+#include "Stats.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const size_t NOT_CACHED = (size_t)-1;
+
+// Interned state sets: the members of set i are pool[offsets[i] .. offsets[i + 1]) in
+// ascending order, and an open-addressing table maps a set's contents to its id.
+//
+// A set's hash is the sum of its members' hashes, so it can be computed while the members
+// are collected in any order, and a lookup compares against the caller's stamp array
+// instead of a sorted copy: only sets that turn out to be new are ever sorted.
+class StateSetTable {
+private:
+    vector<StateId> pool;
+    vector<size_t> offsets;
+    vector<uint64_t> hashes;
+    vector<StateId> slots;    // Set ids, NO_STATE for empty slots
+    size_t mask;
+
+    void grow() {
+        slots.assign(slots.size() * 2, NO_STATE);
+        mask = slots.size() - 1;
+        for (StateId id = 0; id < hashes.size(); ++id) {
+            size_t slot = (size_t)hashes[id] & mask;
+            while (slots[slot] != NO_STATE) slot = (slot + 1) & mask;
+            slots[slot] = id;
+        }
+    }
+
+public:
+    StateSetTable() : offsets(1, 0), slots(1024, NO_STATE), mask(1023) {}
+
+    static uint64_t memberHash(StateId s) {
+        uint64_t h = (s + 1) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 31;
+        h *= 0xFF51AFD7ED558CCDULL;
+        return h ^ (h >> 29);
+    }
+
+    StateId size() const { return (StateId)hashes.size(); }
+    const StateId* begin(StateId id) const { return pool.data() + offsets[id]; }
+    const StateId* end(StateId id) const { return pool.data() + offsets[id + 1]; }
+
+    // Id of the set of distinct `members` (any order) with hash h, whose members are
+    // exactly the states with stamp[s] == epoch. If it is absent and `insert` is set it
+    // is added with the next id and `added` is set; if absent otherwise, returns NO_STATE.
+    StateId find(const vector<StateId>& members, uint64_t h, const vector<uint32_t>& stamp,
+                 uint32_t epoch, bool insert, bool& added) {
+        const uint64_t spread = h ^ (h >> 32);
+        size_t slot = (size_t)spread & mask;
+        added = false;
+        while (slots[slot] != NO_STATE) {
+            StateId id = slots[slot];
+            if (hashes[id] == spread && offsets[id + 1] - offsets[id] == members.size()) {
+                const StateId* s = begin(id);
+                while (s != end(id) && stamp[*s] == epoch) ++s;
+                if (s == end(id)) return id;
+            }
+            slot = (slot + 1) & mask;
+        }
+        if (!insert) return NO_STATE;
+        StateId id = size();
+        slots[slot] = id;
+        hashes.push_back(spread);
+        pool.insert(pool.end(), members.begin(), members.end());
+        sort(pool.begin() + offsets.back(), pool.end());
+        offsets.push_back(pool.size());
+        added = true;
+        if (hashes.size() * 2 > slots.size()) grow();
+        return id;
+    }
+
+    uint64_t memoryBytes() const {
+        return vectorBytes(pool) + vectorBytes(offsets) + vectorBytes(hashes) + vectorBytes(slots);
+    }
+};
+
+}
+
+Nfa::Nfa() : numColumns(0), numStates(0) {
+    symbolToColumn.fill(-1);
+    moveOffsets.assign(1, 0);
+}
+
+void Nfa::reset(const string& symbols, StateId count) {
+    alphabet.assign(symbols.begin(), symbols.end());
+    sort(alphabet.begin(), alphabet.end());
+    alphabet.erase(unique(alphabet.begin(), alphabet.end()), alphabet.end());
+    symbolToColumn.fill(-1);
+    numColumns = 0;
+    numStates = count;
+    startStates.clear();
+    acceptingStates.assign(count, false);
+    edges.clear();
+    symbolSets.clear();
+    symbolSetIds.clear();
+    moves.clear();
+    moveOffsets.assign((size_t)count + 1, 0);
+}
+
+void Nfa::addTransition(StateId from, const vector<bool>& symbols, StateId to) {
+    bitset<256> set;
+    for (int c = 0; c < 256; ++c) {
+        if (symbols[c]) set.set(c);
+    }
+    auto found = symbolSetIds.emplace(set, (uint32_t)symbolSets.size());
+    if (found.second) symbolSets.push_back(set);
+    edges.push_back(Edge{from, found.first->second, to});
+}
+
+void Nfa::finishMoves() {
+    if (startStates.empty()) startStates.push_back(0);
+    sort(startStates.begin(), startStates.end());
+    startStates.erase(unique(startStates.begin(), startStates.end()), startStates.end());
+
+    // -------------------------------
+    // 1. SYMBOL CLASSES: refine the alphabet by every distinct symbol set
+    // -------------------------------
+    array<int, 256> classOf;
+    classOf.fill(-1);
+    for (char symbol : alphabet) classOf[(unsigned char)symbol] = 0;
+    int numClasses = alphabet.empty() ? 0 : 1;
+    vector<int> splitTo;
+    for (const bitset<256>& set : symbolSets) {
+        // Members of a class that are in the set move to a new class, once per class
+        splitTo.assign(numClasses, -1);
+        bool anyOutside = false;
+        vector<bool> classOutside(numClasses, false);
+        for (char symbol : alphabet) {
+            int b = (unsigned char)symbol;
+            if (!set[b]) classOutside[classOf[b]] = anyOutside = true;
+        }
+        if (!anyOutside) continue;
+        for (char symbol : alphabet) {
+            int b = (unsigned char)symbol;
+            int cls = classOf[b];
+            if (!set[b] || !classOutside[cls]) continue;
+            if (splitTo[cls] < 0) splitTo[cls] = numClasses++;
+            classOf[b] = splitTo[cls];
+        }
+    }
+    // Number the classes by their smallest symbol, like Automaton::compressAlphabet()
+    vector<int> renumber(numClasses, -1);
+    numColumns = 0;
+    symbolToColumn.fill(-1);
+    for (char symbol : alphabet) {
+        int b = (unsigned char)symbol;
+        if (renumber[classOf[b]] < 0) renumber[classOf[b]] = (int)numColumns++;
+        symbolToColumn[b] = renumber[classOf[b]];
+    }
+
+    // Each symbol set is a union of whole classes
+    vector<vector<uint32_t>> setColumns(symbolSets.size());
+    for (size_t i = 0; i < symbolSets.size(); ++i) {
+        vector<bool> covered(numColumns, false);
+        for (char symbol : alphabet) {
+            int b = (unsigned char)symbol;
+            if (symbolSets[i][b] && !covered[symbolToColumn[b]]) {
+                covered[symbolToColumn[b]] = true;
+                setColumns[i].push_back((uint32_t)symbolToColumn[b]);
+            }
+        }
+    }
+
+    // -------------------------------
+    // 2. MOVES: bucket the edges by source state, then sort and deduplicate each bucket
+    // -------------------------------
+    moveOffsets.assign((size_t)numStates + 1, 0);
+    for (const Edge& e : edges) {
+        moveOffsets[e.from + 1] += e.symbolSet == EPSILON ? 1 : setColumns[e.symbolSet].size();
+    }
+    for (StateId s = 0; s < numStates; ++s) moveOffsets[s + 1] += moveOffsets[s];
+    moves.resize(moveOffsets[numStates]);
+    vector<size_t> cursor(moveOffsets.begin(), moveOffsets.end() - 1);
+    for (const Edge& e : edges) {
+        if (e.symbolSet == EPSILON) {
+            moves[cursor[e.from]++] = Move{EPSILON, e.to};
+            continue;
+        }
+        for (uint32_t col : setColumns[e.symbolSet]) moves[cursor[e.from]++] = Move{col, e.to};
+    }
+    auto less = [](const Move& a, const Move& b) {
+        return a.column != b.column ? a.column < b.column : a.target < b.target;
+    };
+    auto same = [](const Move& a, const Move& b) { return a.column == b.column && a.target == b.target; };
+    size_t kept = 0;
+    for (StateId s = 0; s < numStates; ++s) {
+        Move* first = moves.data() + moveOffsets[s];
+        Move* last = moves.data() + moveOffsets[s + 1];
+        sort(first, last, less);
+        last = unique(first, last, same);
+        moveOffsets[s] = kept;
+        for (Move* m = first; m != last; ++m) moves[kept++] = *m;
+    }
+    moveOffsets[numStates] = kept;
+    moves.resize(kept);
+
+    vector<Edge>().swap(edges);
+    symbolSets.clear();
+    symbolSetIds.clear();
+}
+
+bool Nfa::determinize(Automaton& dfa, string& error, StateId maxStates) const {
+    STATS_PHASE("determinize");
+    const size_t k = numColumns;
+
+    // -------------------------------
+    // 1. CACHED EPSILON CLOSURES
+    // -------------------------------
+    // A state without epsilon moves is its own closure and is never cached
+    vector<size_t> closureBegin(numStates, NOT_CACHED), closureEnd(numStates, 0);
+    vector<StateId> closures;
+    vector<StateId> stack;
+    vector<uint32_t> stamp(numStates, 0);
+    uint32_t epoch = 0;
+    auto nextEpoch = [&]() {
+        if (++epoch == 0) {
+            fill(stamp.begin(), stamp.end(), 0);
+            epoch = 1;
+        }
+    };
+    auto hasEpsilon = [&](StateId s) {
+        return moveOffsets[s] != moveOffsets[s + 1] && moves[moveOffsets[s + 1] - 1].column == EPSILON;
+    };
+    STATS_ONLY(uint64_t cachedClosures = 0;)
+    auto closure = [&](StateId s) {
+        if (closureBegin[s] != NOT_CACHED) return;
+        STATS_ONLY(++cachedClosures;)
+        nextEpoch();
+        size_t begin = closures.size();
+        stamp[s] = epoch;
+        stack.assign(1, s);
+        while (!stack.empty()) {
+            StateId u = stack.back();
+            stack.pop_back();
+            closures.push_back(u);
+            for (const Move* m = movesEnd(u); m != movesBegin(u) && (m - 1)->column == EPSILON; --m) {
+                StateId v = (m - 1)->target;
+                if (stamp[v] != epoch) {
+                    stamp[v] = epoch;
+                    stack.push_back(v);
+                }
+            }
+        }
+        sort(closures.begin() + begin, closures.end());
+        closureBegin[s] = begin;
+        closureEnd[s] = closures.size();
+    };
+
+    // Add the closure of s to `members`, skipping states already stamped with this epoch
+    vector<StateId> members;
+    uint64_t membersHash = 0;
+    auto addMember = [&](StateId u) {
+        if (stamp[u] == epoch) return;
+        stamp[u] = epoch;
+        members.push_back(u);
+        membersHash += StateSetTable::memberHash(u);
+    };
+    auto addClosure = [&](StateId s) {
+        if (!hasEpsilon(s)) {
+            addMember(s);
+            return;
+        }
+        closure(s);
+        for (size_t i = closureBegin[s]; i < closureEnd[s]; ++i) addMember(closures[i]);
+    };
+    auto startSet = [&]() {
+        members.clear();
+        membersHash = 0;
+        nextEpoch();
+    };
+
+    // -------------------------------
+    // 2. BREADTH-FIRST SEARCH OVER REACHABLE STATE SETS
+    // -------------------------------
+    StateSetTable sets;
+    vector<StateId> table;          // Set id x column, NO_STATE for the empty set
+    vector<bool> accepting;
+    // Id of the set in `members`, numbering it if it is new; NO_STATE past maxStates
+    auto intern = [&]() {
+        bool added;
+        StateId id = sets.find(members, membersHash, stamp, epoch, sets.size() < maxStates, added);
+        if (added) {
+            bool accepts = false;
+            for (StateId s : members) accepts = accepts || acceptingStates[s];
+            accepting.push_back(accepts);
+        }
+        return id;
+    };
+
+    // Closures are computed before a set is assembled, since computing one reuses the stamps
+    for (StateId s : startStates) {
+        if (hasEpsilon(s)) closure(s);
+    }
+    startSet();
+    for (StateId s : startStates) addClosure(s);
+    intern();
+
+    vector<vector<StateId>> targets(k);
+    vector<uint32_t> touched;
+    for (StateId id = 0; id < sets.size(); ++id) {
+        table.resize((size_t)(id + 1) * k, NO_STATE);
+        touched.clear();
+        for (const StateId* s = sets.begin(id); s != sets.end(id); ++s) {
+            for (const Move* m = movesBegin(*s); m != movesEnd(*s) && m->column != EPSILON; ++m) {
+                if (targets[m->column].empty()) touched.push_back(m->column);
+                targets[m->column].push_back(m->target);
+            }
+        }
+        for (uint32_t col : touched) {
+            for (StateId t : targets[col]) {
+                if (hasEpsilon(t)) closure(t);
+            }
+            startSet();
+            for (StateId t : targets[col]) addClosure(t);
+            targets[col].clear();
+            StateId dest = intern();
+            if (dest == NO_STATE) {
+                error = "the subset construction needs more than " + to_string(maxStates) + " states";
+                return false;
+            }
+            table[(size_t)id * k + col] = dest;
+        }
+    }
+    const StateId count = sets.size();
+    STATS_ADD("subset_states", count);
+    STATS_ADD("subset_cached_closures", cachedClosures);
+    STATS_BYTES("subset_sets", sets.memoryBytes() + vectorBytes(table) + vectorBytes(closures));
+
+    // -------------------------------
+    // 3. THE RESULT: a partial DFA, one column per symbol class
+    // -------------------------------
+    dfa.setAlphabetClasses(symbolToColumn);
+    dfa.initStates(count);
+    dfa.setStartState(0);
+    for (StateId id = 0; id < count; ++id) {
+        dfa.setAccepting(id, accepting[id]);
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = table[(size_t)id * k + col];
+            if (dest != NO_STATE) dfa.setTransition(id, col, dest);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,247 @@
+#include "Matcher.h"
+#include "Stats.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Chunks below this size are not worth a thread
+const size_t MIN_CHUNK = (size_t)1 << 16;
+// Up to this many lanes step in lockstep for about the cost of one, so they may run to
+// the end of the chunk. With more, speculation gives up once it has cost 1/8 of a plain
+// run of the chunk, e.g. on permutation automata whose lanes never merge.
+const size_t LOCKSTEP_LANES = 4;
+const size_t SPECULATION_SHARE = 8;
+// Lanes are merged after blocks of 1, 2, 4, ... bytes, up to this many
+const size_t MAX_BLOCK = 256;
+const uint32_t NO_LANE = UINT32_MAX;
+
+// One chunk of the buffer and what the speculative run learned about it
+struct ChunkRun {
+    const unsigned char* data;
+    size_t length;
+    uint64_t base;                 // Offset reported for data[0]
+
+    // Lanes start as one per state (the sink excepted, it only maps to itself) and are
+    // merged whenever two reach the same state. Each merge starts a generation: lane u
+    // of a generation is node generationBase + u, and mergedInto maps every node of an
+    // older generation to its node in the next one. A start state's final state is
+    // found by following its node to the last generation.
+    bool resolved;                 // False if speculation gave up
+    vector<uint32_t> lanes;        // Current state of each lane of the last generation
+    vector<uint32_t> mergedInto;
+    uint32_t generationBase;
+    // Once a single lane is left, every start state (but the sink) follows the same run:
+    // the positions after convergedAt are recorded once, for all of them
+    size_t convergedAt;            // Bytes before the lanes became one, or length
+    vector<uint64_t> positions;
+};
+
+class Speculation {
+private:
+    const Matcher& matcher;
+    const uint32_t* table;
+    const uint32_t* byteClass;
+    uint32_t stride;
+    vector<uint32_t> slotOf;       // Row -> index among the merged lanes, NO_LANE when unused
+    vector<uint32_t> merged;
+    vector<uint32_t> remap;
+    uint32_t columns[MAX_BLOCK];   // Class of each byte of the current block
+
+    // Step every lane over `length` bytes, four lanes in lockstep so their loads overlap
+    void stepLanes(vector<uint32_t>& lanes, const unsigned char* data, size_t length) {
+        for (size_t i = 0; i < length; ++i) columns[i] = byteClass[data[i]];
+        const uint32_t* t = table;
+        size_t u = 0;
+        for (; u + 4 <= lanes.size(); u += 4) {
+            uint32_t s0 = lanes[u], s1 = lanes[u + 1], s2 = lanes[u + 2], s3 = lanes[u + 3];
+            for (size_t i = 0; i < length; ++i) {
+                s0 = t[s0 + columns[i]];
+                s1 = t[s1 + columns[i]];
+                s2 = t[s2 + columns[i]];
+                s3 = t[s3 + columns[i]];
+            }
+            lanes[u] = s0; lanes[u + 1] = s1; lanes[u + 2] = s2; lanes[u + 3] = s3;
+        }
+        for (; u < lanes.size(); ++u) {
+            uint32_t s = lanes[u];
+            for (size_t i = 0; i < length; ++i) s = t[s + columns[i]];
+            lanes[u] = s;
+        }
+    }
+
+    // Merge lanes in the same state into a new generation
+    void mergeLanes(ChunkRun& run) {
+        merged.clear();
+        remap.resize(run.lanes.size());
+        for (size_t u = 0; u < run.lanes.size(); ++u) {
+            uint32_t& slot = slotOf[run.lanes[u] / stride];
+            if (slot == NO_LANE) {
+                slot = (uint32_t)merged.size();
+                merged.push_back(run.lanes[u]);
+            }
+            remap[u] = slot;
+        }
+        for (uint32_t state : merged) slotOf[state / stride] = NO_LANE;
+        if (merged.size() == run.lanes.size()) return;
+        const uint32_t nextBase = (uint32_t)run.mergedInto.size();
+        for (size_t u = 0; u < run.lanes.size(); ++u) run.mergedInto[run.generationBase + u] = nextBase + remap[u];
+        run.mergedInto.resize(nextBase + merged.size(), NO_LANE);
+        run.generationBase = nextBase;
+        run.lanes.swap(merged);
+    }
+
+public:
+    Speculation(const Matcher& matcher, const uint32_t* table, const uint32_t* byteClass, uint32_t stride,
+                uint32_t numStates)
+        : matcher(matcher), table(table), byteClass(byteClass), stride(stride), slotOf(numStates, NO_LANE) {}
+
+    void speculate(ChunkRun& run, uint32_t numStates, bool wantPositions) {
+        run.lanes.resize(numStates - 1);
+        for (uint32_t row = 1; row < numStates; ++row) run.lanes[row - 1] = row * stride;
+        run.mergedInto.assign(run.lanes.size(), NO_LANE);
+        run.generationBase = 0;
+        run.resolved = true;
+        run.convergedAt = run.length;
+
+        const size_t budget = run.length / SPECULATION_SHARE;
+        size_t spent = 0;
+        size_t done = 0;
+        size_t block = 1;
+        while (done < run.length && run.lanes.size() > 1) {
+            if (run.lanes.size() > LOCKSTEP_LANES && spent > budget) {
+                run.resolved = false;
+                return;
+            }
+            size_t length = min(block, run.length - done);
+            stepLanes(run.lanes, run.data + done, length);
+            spent += length * run.lanes.size();
+            done += length;
+            block = min(block * 2, MAX_BLOCK);
+            mergeLanes(run);
+        }
+        if (run.lanes.size() != 1) return;
+
+        // A single lane is left: finish the chunk as a plain run
+        run.convergedAt = done;
+        if (wantPositions) {
+            run.lanes[0] = matcher.findAccepts(run.lanes[0], run.data + done, run.length - done, run.base + done,
+                                               run.positions);
+        } else {
+            run.lanes[0] = matcher.feed(run.lanes[0], run.data + done, run.length - done);
+        }
+    }
+
+    // The state the chunk ends in when entered in `state`
+    static uint32_t endState(const ChunkRun& run, uint32_t state, uint32_t stride) {
+        if (state == 0) return 0;
+        uint32_t node = state / stride - 1;
+        while (run.mergedInto[node] != NO_LANE) node = run.mergedInto[node];
+        return run.lanes[node - run.generationBase];
+    }
+};
+
+}
+
+uint32_t Matcher::findAcceptsParallel(uint32_t state, const unsigned char* data, size_t length, uint64_t base,
+                                      vector<uint64_t>& positions, unsigned numThreads) const {
+    return runParallel(state, data, length, base, &positions, numThreads);
+}
+
+uint32_t Matcher::feedParallel(uint32_t state, const unsigned char* data, size_t length, unsigned numThreads) const {
+    return runParallel(state, data, length, 0, nullptr, numThreads);
+}
+
+bool Matcher::matchesParallel(const unsigned char* data, size_t length, unsigned numThreads) const {
+    return isAccepting(feedParallel(startState, data, length, numThreads));
+}
+
+uint32_t Matcher::runParallel(uint32_t state, const unsigned char* data, size_t length, uint64_t base,
+                              vector<uint64_t>* positions, unsigned numThreads) const {
+    STATS_PHASE("match_parallel");
+    if (numThreads == 0) numThreads = max(1u, thread::hardware_concurrency());
+    const size_t numChunks = max<size_t>(1, min<size_t>(numThreads, length / MIN_CHUNK));
+    if (numChunks == 1 || numStates <= 1) {
+        return positions ? findAccepts(state, data, length, base, *positions) : feed(state, data, length);
+    }
+
+    // -------------------------------
+    // 1. SPECULATION: the first chunk runs from `state`, the others from all states
+    // -------------------------------
+    vector<ChunkRun> runs(numChunks);
+    for (size_t c = 0; c < numChunks; ++c) {
+        size_t begin = length / numChunks * c;
+        size_t end = c + 1 == numChunks ? length : length / numChunks * (c + 1);
+        runs[c].data = data + begin;
+        runs[c].length = end - begin;
+        runs[c].base = base + begin;
+    }
+    uint32_t firstEnd = 0;
+    vector<thread> pool;
+    for (size_t c = 1; c < numChunks; ++c) {
+        pool.emplace_back([&, c] {
+            Speculation speculation(*this, table.data(), byteClass.data(), stride, numStates);
+            speculation.speculate(runs[c], numStates, positions != nullptr);
+        });
+    }
+    if (positions) {
+        firstEnd = findAccepts(state, runs[0].data, runs[0].length, runs[0].base, *positions);
+    } else {
+        firstEnd = feed(state, runs[0].data, runs[0].length);
+    }
+    for (thread& t : pool) t.join();
+    pool.clear();
+
+    // -------------------------------
+    // 2. STITCHING: map the state each chunk is entered in to the state it ends in.
+    // A chunk whose speculation gave up is run here, from the now known state.
+    // -------------------------------
+    vector<uint32_t> entry(numChunks);
+    entry[0] = state;
+    uint32_t current = firstEnd;
+    size_t abandoned = 0;
+    for (size_t c = 1; c < numChunks; ++c) {
+        entry[c] = current;
+        ChunkRun& run = runs[c];
+        if (!run.resolved) {
+            ++abandoned;
+            run.positions.clear();
+            if (positions) {
+                current = findAccepts(current, run.data, run.length, run.base, run.positions);
+            } else {
+                current = feed(current, run.data, run.length);
+            }
+            run.convergedAt = 0;
+            continue;
+        }
+        current = Speculation::endState(run, current, stride);
+        // The sink never accepts, and whatever the lanes recorded is for other states
+        if (entry[c] == 0) {
+            run.positions.clear();
+            run.convergedAt = 0;
+        }
+    }
+    STATS_ADD("match_chunks", numChunks);
+    STATS_ADD("match_chunks_abandoned", abandoned);
+    if (!positions) return current;
+
+    // -------------------------------
+    // 3. POSITIONS: rerun each speculated chunk from its entry state up to the point
+    // where its lanes converged, then append what the converged lane recorded
+    // -------------------------------
+    vector<vector<uint64_t>> prefixes(numChunks);
+    for (size_t c = 1; c < numChunks; ++c) {
+        if (runs[c].convergedAt == 0) continue;
+        pool.emplace_back([&, c] {
+            findAccepts(entry[c], runs[c].data, runs[c].convergedAt, runs[c].base, prefixes[c]);
+        });
+    }
+    for (thread& t : pool) t.join();
+    for (size_t c = 1; c < numChunks; ++c) {
+        positions->insert(positions->end(), prefixes[c].begin(), prefixes[c].end());
+        positions->insert(positions->end(), runs[c].positions.begin(), runs[c].positions.end());
+    }
+    return current;
+}
@@ -0,0 +1,186 @@
+#include "Automaton.h"
+#include "Utils.h"
+#include "Stats.h"
+#include <thread>
+
+using namespace std;
+
+// Fold one value into a running 64-bit signature hash
+static inline uint64_t mixHash(uint64_t h, uint64_t v) {
+    h ^= v + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 31);
+}
+
+// Minimize DFA by parallel signature refinement.
+// Every round gives each state the signature (current block, blocks of its successors)
+// and numbers the distinct signatures as the next round's blocks. States are sharded by
+// signature hash so each shard can be numbered independently; the partition is stable
+// when a round no longer increases the number of blocks.
+Automaton Automaton::minimizeDFAParallel(unsigned numThreads, bool consume) {
+    STATS_PHASE("minimize_parallel");
+    // Merge the dead states into one sink as minimizeDFA() does, then ensure the DFA is
+    // complete (every state has a transition for each symbol) and work on symbol classes
+    StateId collapsed = collapseDeadStates();
+    completeDFA();
+    compressAlphabet();
+    if (numThreads == 0) numThreads = max(1u, thread::hardware_concurrency());
+    if (verbose) cout << "\nMinimizing DFA using parallel signature refinement (" << numThreads << " threads)...\n";
+
+    const size_t k = numColumns;
+    const StateId n = numStates;
+    const StateId* table = transitions.data();
+
+    // Small inputs are not worth a thread per core
+    const unsigned workers = (unsigned)max<size_t>(1, min<size_t>(numThreads, n / 4096));
+    const size_t numShards = workers == 1 ? 1 : (size_t)workers * 4;
+
+    // -------------------------------
+    // 1. INITIAL PARTITION: accepting vs non-accepting
+    // -------------------------------
+    vector<BlockId> block(n), nextBlock(n);
+    bool anyAccepting = false, anyRejecting = false;
+    for (StateId s = 0; s < n; ++s) {
+        if (acceptingStates[s]) anyAccepting = true; else anyRejecting = true;
+    }
+    for (StateId s = 0; s < n; ++s) {
+        block[s] = (anyAccepting && anyRejecting && acceptingStates[s]) ? 1 : 0;
+    }
+    size_t numBlocks = (anyAccepting && anyRejecting) ? 2 : 1;
+
+    vector<uint64_t> sigHash(n);
+    vector<uint32_t> localId(n);
+    vector<StateId> shardStates(n);
+    vector<size_t> shardStart(numShards + 1);
+    vector<size_t> shardBlocks(numShards);
+    vector<vector<size_t>> shardCounts(workers, vector<size_t>(numShards));
+
+    auto sameSignature = [&](StateId a, StateId b) {
+        if (block[a] != block[b]) return false;
+        const StateId* rowA = table + (size_t)a * k;
+        const StateId* rowB = table + (size_t)b * k;
+        for (size_t col = 0; col < k; ++col) {
+            if (block[rowA[col]] != block[rowB[col]]) return false;
+        }
+        return true;
+    };
+
+    // -------------------------------
+    // 2. REFINEMENT ROUNDS
+    // -------------------------------
+    // The workers are started once and go through every round together. Each phase
+    // works on the thread's own chunk of states (or shards), and a barrier separates it
+    // from the next; the serial steps run in the barrier's completion.
+    {
+        STATS_PHASE("refine");
+        STATS_ONLY(uint64_t rounds = 0;)
+        bool stable = false;
+        utils::Barrier barrier(workers);
+
+        auto refine = [&](unsigned t) {
+            size_t stateBegin, stateEnd, shardBegin, shardEnd;
+            utils::chunkRange(n, workers, t, stateBegin, stateEnd);
+            utils::chunkRange(numShards, workers, t, shardBegin, shardEnd);
+            vector<size_t>& counts = shardCounts[t];
+            vector<StateId> slots;
+            while (true) {
+                // Signature hashes, and how many states of this chunk fall into each shard
+                fill(counts.begin(), counts.end(), 0);
+                for (size_t s = stateBegin; s < stateEnd; ++s) {
+                    uint64_t h = mixHash(0, block[s]);
+                    const StateId* row = table + s * k;
+                    for (size_t col = 0; col < k; ++col) h = mixHash(h, block[row[col]]);
+                    sigHash[s] = h;
+                    ++counts[h % numShards];
+                }
+                // Each chunk's counts become its fill positions in every shard
+                barrier.arriveAndWait([&] {
+                    STATS_ONLY(++rounds;)
+                    size_t offset = 0;
+                    for (size_t shard = 0; shard < numShards; ++shard) {
+                        shardStart[shard] = offset;
+                        for (unsigned w = 0; w < workers; ++w) {
+                            size_t count = shardCounts[w][shard];
+                            shardCounts[w][shard] = offset;
+                            offset += count;
+                        }
+                    }
+                    shardStart[numShards] = offset;
+                });
+
+                // Scatter states into their shards, keeping state order within each shard
+                for (size_t s = stateBegin; s < stateEnd; ++s) {
+                    shardStates[counts[sigHash[s] % numShards]++] = (StateId)s;
+                }
+                barrier.arriveAndWait();
+
+                // Number the distinct signatures of each shard with an open-addressing table
+                for (size_t shard = shardBegin; shard < shardEnd; ++shard) {
+                    size_t size = shardStart[shard + 1] - shardStart[shard];
+                    size_t capacity = 16;
+                    while (capacity < size * 2) capacity <<= 1;
+                    slots.assign(capacity, NO_STATE);
+                    uint32_t distinct = 0;
+                    for (size_t i = shardStart[shard]; i < shardStart[shard + 1]; ++i) {
+                        StateId s = shardStates[i];
+                        size_t slot = (sigHash[s] >> 20) & (capacity - 1);
+                        while (true) {
+                            StateId rep = slots[slot];
+                            if (rep == NO_STATE) {
+                                slots[slot] = s;
+                                localId[s] = distinct++;
+                                break;
+                            }
+                            if (sigHash[rep] == sigHash[s] && sameSignature(rep, s)) {
+                                localId[s] = localId[rep];
+                                break;
+                            }
+                            slot = (slot + 1) & (capacity - 1);
+                        }
+                    }
+                    shardBlocks[shard] = distinct;
+                }
+                // Global block number = blocks in earlier shards + number within the shard
+                barrier.arriveAndWait([&] {
+                    size_t total = 0;
+                    for (size_t shard = 0; shard < numShards; ++shard) {
+                        size_t count = shardBlocks[shard];
+                        shardBlocks[shard] = total;
+                        total += count;
+                    }
+                    stable = total == numBlocks;
+                    numBlocks = total;
+                });
+                if (stable) break;
+
+                for (size_t s = stateBegin; s < stateEnd; ++s) {
+                    nextBlock[s] = (BlockId)(shardBlocks[sigHash[s] % numShards] + localId[s]);
+                }
+                barrier.arriveAndWait([&] { block.swap(nextBlock); });
+            }
+        };
+
+        vector<thread> pool;
+        for (unsigned t = 1; t < workers; ++t) pool.emplace_back(refine, t);
+        refine(0);
+        for (thread& worker : pool) worker.join();
+        STATS_ADD("parallel_rounds", rounds);
+    }
+
+    STATS_PEAK("blocks", numBlocks);
+    STATS_BYTES("transitions", vectorBytes(transitions));
+    STATS_BYTES("signatures", vectorBytes(block) + vectorBytes(nextBlock) + vectorBytes(sigHash) +
+                              vectorBytes(localId) + vectorBytes(shardStates));
+
+    // -------------------------------
+    // 3. CHECK IF ALREADY MINIMIZED
+    if (collapsed == 0 && numBlocks == n) {
+        if (verbose) cout << "The DFA is already minimized.\n";
+        if (consume) return move(*this);
+        return *this;
+    }
+
+    // -------------------------------
+    // 4. BUILDING THE MINIMIZED DFA
+    return buildQuotient(block, numBlocks);
+}
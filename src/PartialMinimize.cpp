@@ -0,0 +1,146 @@
+#include "Automaton.h"
+#include "Partition.h"
+#include "Stats.h"
+
+using namespace std;
+
+// Minimize a partial DFA by Valmari and Lehtinen's refinement.
+// Besides the partition of the states into blocks it keeps a partition of the defined
+// transitions into "cords", starting with one cord per symbol. Each cord splits the
+// blocks by the states it leaves from, and each new block splits the cords by the
+// transitions entering it. Splits keep the larger half under the old index and append
+// the smaller one, so every set is processed O(log n) times and the whole run costs
+// O(m log n) for m defined transitions. Missing transitions are never materialized.
+Automaton Automaton::minimizePartialDFA(bool consume) {
+    STATS_PHASE("minimize_partial");
+    compressAlphabet();
+    if (verbose) cout << "\nMinimizing partial DFA using Valmari-Lehtinen refinement...\n";
+    const size_t k = numColumns;
+    const StateId n = numStates;
+
+    // -------------------------------
+    // 1. RELEVANT STATES: reachable from the start and able to reach an accepting state
+    // -------------------------------
+    vector<bool> relevant;
+    computeCoReachability(relevant, true);
+
+    vector<BlockId> blockOf(n, NO_STATE);
+    if (!relevant[startState]) {
+        // Empty language: a single rejecting start state without transitions
+        blockOf[startState] = 0;
+        Automaton empty = buildQuotient(blockOf, 1);
+        fill(empty.transitions.begin(), empty.transitions.end(), NO_STATE);
+        return empty;
+    }
+
+    vector<StateId> localOf(n, NO_STATE);
+    StateId r = 0;
+    for (StateId s = 0; s < n; ++s) {
+        if (relevant[s]) localOf[s] = r++;
+    }
+
+    // -------------------------------
+    // 2. TRANSITIONS between relevant states; the others point into the implicit sink
+    // -------------------------------
+    vector<StateId> tail, head;
+    vector<BlockId> label;
+    for (StateId s = 0; s < n; ++s) {
+        if (!relevant[s]) continue;
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            if (dest == NO_STATE || !relevant[dest]) continue;
+            tail.push_back(localOf[s]);
+            head.push_back(localOf[dest]);
+            label.push_back((BlockId)col);
+        }
+    }
+    const size_t m = tail.size();
+    if (m >= NO_STATE) {
+        // Transition indices would not fit a StateId: minimize the completed DFA, whose
+        // partition is over states only, and drop its sink again
+        if (verbose) cout << "Too many transitions for partial refinement (" << m << "), minimizing the completed DFA.\n";
+        vector<StateId>().swap(tail);
+        vector<StateId>().swap(head);
+        vector<BlockId>().swap(label);
+        MinimizeScratch scratch;
+        Automaton minimized = minimizeDFA(scratch, consume);
+        minimized.collapseDeadStates(false);
+        // Name the states as buildQuotient would, unless nothing was merged
+        if (minimized.numStates != n) {
+            for (StateId s = 0; s < minimized.numStates; ++s) minimized.stateNames[s] = "Q" + to_string(s);
+        }
+        return minimized;
+    }
+
+    // Transitions entering each state, in CSR form
+    vector<size_t> inOffsets(r + 1, 0);
+    for (size_t t = 0; t < m; ++t) ++inOffsets[head[t] + 1];
+    for (StateId s = 0; s < r; ++s) inOffsets[s + 1] += inOffsets[s];
+    vector<StateId> inTransitions(m);
+    for (size_t t = 0; t < m; ++t) inTransitions[inOffsets[head[t]]++] = (StateId)t;
+    for (StateId s = r; s > 0; --s) inOffsets[s] = inOffsets[s - 1];
+    inOffsets[0] = 0;
+
+    // -------------------------------
+    // 3. INITIAL PARTITIONS: blocks by acceptance, cords by symbol
+    // -------------------------------
+    vector<BlockId> initial(r);
+    for (StateId s = 0; s < n; ++s) {
+        if (relevant[s]) initial[localOf[s]] = acceptingStates[s] ? 1 : 0;
+    }
+    Partition blocks, cords;
+    blocks.reset(initial, 2);
+    cords.reset(label, k);
+    vector<BlockId>().swap(initial);
+    vector<BlockId>().swap(label);
+
+    // -------------------------------
+    // 4. REFINING: cords split blocks, new blocks split cords
+    // -------------------------------
+    // Block 0 never needs to be a splitter: its predecessors on a symbol are the
+    // cord of that symbol minus the predecessors of the other blocks
+    vector<pair<BlockId, BlockId>> splits;
+    size_t nextBlock = 1;
+    STATS_ONLY(uint64_t blockSplits = 0; uint64_t cordSplits = 0;)
+    {
+        STATS_PHASE("refine");
+        for (size_t c = 0; c < cords.blockCount(); ++c) {
+            for (const StateId* t = cords.begin((BlockId)c); t != cords.end((BlockId)c); ++t) {
+                blocks.mark(tail[*t]);
+            }
+            splits.clear();
+            blocks.splitMarked(splits, true);
+            STATS_ONLY(blockSplits += splits.size();)
+
+            for (; nextBlock < blocks.blockCount(); ++nextBlock) {
+                for (const StateId* s = blocks.begin((BlockId)nextBlock); s != blocks.end((BlockId)nextBlock); ++s) {
+                    for (size_t i = inOffsets[*s]; i < inOffsets[*s + 1]; ++i) cords.mark(inTransitions[i]);
+                }
+                splits.clear();
+                cords.splitMarked(splits, true);
+                STATS_ONLY(cordSplits += splits.size();)
+            }
+        }
+    }
+    STATS_ADD("refine_splitters", cords.blockCount() + blocks.blockCount() - 1);
+    STATS_ADD("refine_splits", blockSplits);
+    STATS_ADD("cord_splits", cordSplits);
+    STATS_PEAK("blocks", blocks.blockCount());
+    STATS_BYTES("transitions", vectorBytes(transitions));
+    STATS_BYTES("partial_transitions", vectorBytes(tail) + vectorBytes(head) + vectorBytes(inOffsets) +
+                                       vectorBytes(inTransitions));
+    STATS_BYTES("partition", blocks.memoryBytes() + cords.memoryBytes());
+
+    // -------------------------------
+    // 5. BUILDING THE MINIMIZED PARTIAL DFA
+    // -------------------------------
+    if (r == n && blocks.blockCount() == n) {
+        if (verbose) cout << "The DFA is already minimized.\n";
+        if (consume) return move(*this);
+        return *this;
+    }
+    for (StateId s = 0; s < n; ++s) {
+        if (relevant[s]) blockOf[s] = blocks.blockOf(localOf[s]);
+    }
+    return buildQuotient(blockOf, blocks.blockCount());
+}
@@ -0,0 +1,217 @@
+#include "Partition.h"
+#include "Stats.h"
+
+using namespace std;
+
+void Partition::reset(StateId n) {
+    elements.resize(n);
+    position.resize(n);
+    blockOfState.assign(n, 0);
+    for (StateId s = 0; s < n; ++s) {
+        elements[s] = s;
+        position[s] = s;
+    }
+    blockStart.clear();
+    blockEnd.clear();
+    blockMid.clear();
+    touched.clear();
+    if (n > 0) {
+        blockStart.push_back(0);
+        blockEnd.push_back(n);
+        blockMid.push_back(0);
+    }
+}
+
+void Partition::reset(const vector<BlockId>& initial, size_t numBlocks) {
+    const StateId n = (StateId)initial.size();
+    vector<size_t> count(numBlocks, 0);
+    for (BlockId b : initial) ++count[b];
+
+    // Non-empty blocks get consecutive ids; count[] becomes each block's fill position
+    vector<BlockId> newId(numBlocks, 0);
+    blockStart.clear();
+    blockEnd.clear();
+    size_t pos = 0;
+    for (size_t b = 0; b < numBlocks; ++b) {
+        if (count[b] == 0) continue;
+        newId[b] = (BlockId)blockStart.size();
+        blockStart.push_back(pos);
+        pos += count[b];
+        blockEnd.push_back(pos);
+        count[b] = blockStart.back();
+    }
+    blockMid = blockStart;
+    touched.clear();
+
+    elements.resize(n);
+    position.resize(n);
+    blockOfState.resize(n);
+    for (StateId s = 0; s < n; ++s) {
+        size_t at = count[initial[s]]++;
+        elements[at] = s;
+        position[s] = at;
+        blockOfState[s] = newId[initial[s]];
+    }
+}
+
+void Partition::mark(StateId s) {
+    BlockId b = blockOfState[s];
+    size_t pos = position[s];
+    size_t mid = blockMid[b];
+    if (pos < mid) return; // Already marked
+
+    if (mid == blockStart[b]) touched.push_back(b);
+
+    // Swap s with the first unmarked element of its block
+    StateId other = elements[mid];
+    elements[pos] = other;
+    position[other] = pos;
+    elements[mid] = s;
+    position[s] = mid;
+    blockMid[b] = mid + 1;
+}
+
+void Partition::splitMarked(vector<pair<BlockId, BlockId>>& splits, bool smallerIsNew) {
+    for (BlockId b : touched) {
+        size_t start = blockStart[b];
+        size_t mid = blockMid[b];
+        size_t end = blockEnd[b];
+        blockMid[b] = start;
+        if (mid == end) continue; // Every state was marked: nothing to split
+
+        BlockId nb = (BlockId)blockStart.size();
+        if (smallerIsNew && mid - start > end - mid) {
+            // The unmarked suffix [mid, end) is smaller and becomes the new block
+            blockStart.push_back(mid);
+            blockEnd.push_back(end);
+            blockMid.push_back(mid);
+            blockEnd[b] = mid;
+            for (size_t i = mid; i < end; ++i) {
+                blockOfState[elements[i]] = nb;
+            }
+            splits.push_back(make_pair(b, nb));
+            continue;
+        }
+
+        // The marked prefix [start, mid) becomes the new block
+        blockStart.push_back(start);
+        blockEnd.push_back(mid);
+        blockMid.push_back(start);
+        blockStart[b] = mid;
+        blockMid[b] = mid;
+        for (size_t i = start; i < mid; ++i) {
+            blockOfState[elements[i]] = nb;
+        }
+        splits.push_back(make_pair(b, nb));
+    }
+    touched.clear();
+}
+
+uint64_t Partition::memoryBytes() const {
+    return vectorBytes(elements) + vectorBytes(position) + vectorBytes(blockOfState) +
+           vectorBytes(blockStart) + vectorBytes(blockEnd) + vectorBytes(blockMid) + vectorBytes(touched);
+}
+
+void buildInverseTransitions(const vector<StateId>& transitions, StateId numStates, size_t numColumns,
+                             vector<size_t>& offsets, vector<StateId>& sources) {
+    const size_t k = numColumns;
+    const size_t keys = k * numStates;
+
+    // Count predecessors per (symbol, destination), then prefix-sum into offsets
+    offsets.assign(keys + 1, 0);
+    for (StateId s = 0; s < numStates; ++s) {
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            if (dest != NO_STATE) ++offsets[col * numStates + dest + 1];
+        }
+    }
+    for (size_t key = 0; key < keys; ++key) offsets[key + 1] += offsets[key];
+
+    // Fill using offsets[key] as the cursor of key; afterwards it holds the end of key,
+    // which is the start of key + 1, so shifting by one restores the offsets
+    sources.resize(offsets[keys]);
+    for (StateId s = 0; s < numStates; ++s) {
+        for (size_t col = 0; col < k; ++col) {
+            StateId dest = transitions[(size_t)s * k + col];
+            if (dest != NO_STATE) sources[offsets[col * numStates + dest]++] = s;
+        }
+    }
+    for (size_t key = keys; key > 0; --key) offsets[key] = offsets[key - 1];
+    offsets[0] = 0;
+}
+
+void refinePartition(MinimizeScratch& scratch, size_t numColumns) {
+    const size_t k = numColumns;
+    Partition& P = scratch.partition;
+    const size_t numStates = P.blockIds().size();
+    const vector<size_t>& invOffsets = scratch.invOffsets;
+    const vector<StateId>& invSources = scratch.invSources;
+
+    // The worklist holds (block, symbol) splitters; inWorklist gives O(1) membership
+    vector<pair<BlockId, size_t>>& W = scratch.worklist;
+    vector<bool>& inWorklist = scratch.inWorklist;
+    W.clear();
+    inWorklist.assign(P.blockCount() * k, false);
+    auto pushSplitter = [&](BlockId b, size_t col) {
+        if (inWorklist[b * k + col]) return;
+        inWorklist[b * k + col] = true;
+        W.push_back(make_pair(b, col));
+    };
+    if (P.blockCount() > 1) {
+        BlockId largest = 0;
+        for (BlockId b = 1; b < P.blockCount(); ++b) {
+            if (P.blockSize(b) > P.blockSize(largest)) largest = b;
+        }
+        for (BlockId b = 0; b < P.blockCount(); ++b) {
+            if (b == largest) continue;
+            for (size_t col = 0; col < k; ++col) pushSplitter(b, col);
+        }
+    }
+
+    vector<StateId>& predecessors = scratch.predecessors;
+    vector<pair<BlockId, BlockId>>& splits = scratch.splits;
+    STATS_ONLY(uint64_t splitters = 0; uint64_t blockSplits = 0; uint64_t pushes = W.size();)
+    while (!W.empty()) {
+        STATS_ONLY(++splitters;)
+        BlockId A = W.back().first;
+        size_t col = W.back().second;
+        W.pop_back();
+        inWorklist[A * k + col] = false;
+
+        // Gather the predecessors first: marking reorders elements, possibly inside A itself
+        predecessors.clear();
+        for (const StateId* it = P.begin(A); it != P.end(A); ++it) {
+            size_t key = col * numStates + *it;
+            predecessors.insert(predecessors.end(),
+                                invSources.begin() + invOffsets[key],
+                                invSources.begin() + invOffsets[key + 1]);
+        }
+        for (StateId s : predecessors) P.mark(s);
+
+        splits.clear();
+        P.splitMarked(splits);
+        if (splits.empty()) continue;
+        STATS_ONLY(blockSplits += splits.size(); size_t pending = W.size();)
+        inWorklist.resize(P.blockCount() * k, false);
+
+        for (const auto& split : splits) {
+            BlockId Y = split.first, Z = split.second;
+            BlockId smaller = P.blockSize(Z) <= P.blockSize(Y) ? Z : Y;
+            for (size_t c = 0; c < k; ++c) {
+                // A pending splitter for Y must now cover both halves
+                if (inWorklist[Y * k + c])
+                    pushSplitter(Z, c);
+                else
+                    pushSplitter(smaller, c);
+            }
+        }
+        STATS_ONLY(pushes += W.size() - pending;)
+    }
+
+    STATS_ADD("refine_splitters", splitters);
+    STATS_ADD("refine_splits", blockSplits);
+    STATS_ADD("worklist_pushes", pushes);
+    STATS_PEAK("blocks", P.blockCount());
+    STATS_BYTES("partition", P.memoryBytes());
+    STATS_BYTES("worklist", vectorBytes(W) + vectorBytes(inWorklist) + vectorBytes(predecessors));
+}
@@ -0,0 +1,259 @@
+#include "Product.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace {
+
+// Open-addressing hash map from a packed state pair to its product id. The key of the
+// pair (sink, sink) marks empty slots; that pair is dead under every operation and is
+// never inserted.
+class PairTable {
+private:
+    static const uint64_t EMPTY = ~(uint64_t)0;
+    vector<uint64_t> keys;
+    vector<StateId> ids;
+    size_t mask;
+    size_t count;
+
+    static size_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key >> 33;
+        return (size_t)key;
+    }
+
+    void grow() {
+        vector<uint64_t> oldKeys(keys.size() * 2, EMPTY);
+        vector<StateId> oldIds(ids.size() * 2);
+        oldKeys.swap(keys);
+        oldIds.swap(ids);
+        mask = keys.size() - 1;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldKeys[i] == EMPTY) continue;
+            size_t slot = hash(oldKeys[i]) & mask;
+            while (keys[slot] != EMPTY) slot = (slot + 1) & mask;
+            keys[slot] = oldKeys[i];
+            ids[slot] = oldIds[i];
+        }
+    }
+
+public:
+    PairTable() : keys(1024, EMPTY), ids(1024), mask(1023), count(0) {}
+
+    static uint64_t pack(StateId a, StateId b) { return ((uint64_t)a << 32) | b; }
+
+    // Id of the pair; if absent it is added with id `next` and `added` is set
+    StateId find(uint64_t key, StateId next, bool& added) {
+        size_t slot = hash(key) & mask;
+        while (keys[slot] != EMPTY) {
+            if (keys[slot] == key) {
+                added = false;
+                return ids[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = key;
+        ids[slot] = next;
+        added = true;
+        if (++count * 2 > keys.size()) grow();
+        return next;
+    }
+
+    uint64_t memoryBytes() const { return vectorBytes(keys) + vectorBytes(ids); }
+};
+
+// Extend `marked` to every state of a row-major n x k table that reaches a marked state
+void markBackward(const vector<StateId>& table, StateId n, size_t k, vector<bool>& marked) {
+    vector<size_t> offsets(n + 1, 0);
+    for (StateId dest : table) {
+        if (dest != NO_STATE) ++offsets[dest + 1];
+    }
+    for (StateId s = 0; s < n; ++s) offsets[s + 1] += offsets[s];
+    vector<StateId> preds(offsets[n]);
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (table[i] != NO_STATE) preds[offsets[table[i]]++] = (StateId)(i / k);
+    }
+    for (StateId s = n; s > 0; --s) offsets[s] = offsets[s - 1];
+    offsets[0] = 0;
+
+    vector<StateId> stack;
+    for (StateId s = 0; s < n; ++s) {
+        if (marked[s]) stack.push_back(s);
+    }
+    while (!stack.empty()) {
+        StateId s = stack.back();
+        stack.pop_back();
+        for (size_t i = offsets[s]; i < offsets[s + 1]; ++i) {
+            if (!marked[preds[i]]) {
+                marked[preds[i]] = true;
+                stack.push_back(preds[i]);
+            }
+        }
+    }
+}
+
+// canAccept[s]: some string leads from s to acceptance. canReject[s]: some string leads
+// from s to rejection, including through the implicit sink. `missingSymbols` says
+// whether the joint alphabet has symbols this automaton lacks.
+void computeLiveness(const Automaton& dfa, bool missingSymbols, vector<bool>& canAccept,
+                     vector<bool>& canReject) {
+    const StateId n = dfa.getNumStates();
+    const size_t k = dfa.getNumColumns();
+    canAccept.assign(n, false);
+    canReject.assign(n, missingSymbols);
+    for (StateId s = 0; s < n; ++s) {
+        canAccept[s] = dfa.isAccepting(s);
+        if (!dfa.isAccepting(s)) canReject[s] = true;
+        for (size_t col = 0; col < k && !canReject[s]; ++col) {
+            if (dfa.getTransition(s, col) == NO_STATE) canReject[s] = true;
+        }
+    }
+    markBackward(dfa.getTransitionTable(), n, k, canAccept);
+    if (!missingSymbols) markBackward(dfa.getTransitionTable(), n, k, canReject);
+}
+
+bool combine(ProductOperation op, bool first, bool second) {
+    switch (op) {
+    case ProductOperation::Intersection: return first && second;
+    case ProductOperation::Union: return first || second;
+    case ProductOperation::Difference: return first && !second;
+    }
+    return false;
+}
+
+}
+
+void computeJointClasses(const Automaton& first, const Automaton& second, JointClasses& classes) {
+    const size_t k2 = second.getNumColumns();
+    vector<int> classOfColumns((first.getNumColumns() + 1) * (k2 + 1), -1);
+    classes.firstColumn.clear();
+    classes.secondColumn.clear();
+    classes.symbol.clear();
+    classes.classOfSymbol.fill(-1);
+    for (int b = 0; b < 256; ++b) {
+        int c1 = first.getColumn((char)b), c2 = second.getColumn((char)b);
+        if (c1 < 0 && c2 < 0) continue;
+        int& cls = classOfColumns[(size_t)(c1 + 1) * (k2 + 1) + (c2 + 1)];
+        if (cls < 0) {
+            cls = (int)classes.symbol.size();
+            classes.firstColumn.push_back(c1);
+            classes.secondColumn.push_back(c2);
+            classes.symbol.push_back((char)b);
+        }
+        classes.classOfSymbol[b] = cls;
+    }
+}
+
+bool buildProduct(const Automaton& first, const Automaton& second, ProductOperation op,
+                  Automaton& result, string& error) {
+    STATS_PHASE("product");
+    JointClasses classes;
+    computeJointClasses(first, second, classes);
+    const size_t k = classes.symbol.size();
+    const StateId n1 = first.getNumStates(), n2 = second.getNumStates();
+
+    // -------------------------------
+    // 1. LIVENESS OF THE COMPONENTS
+    // -------------------------------
+    bool firstMissing = false, secondMissing = false;
+    for (size_t cls = 0; cls < k; ++cls) {
+        if (classes.firstColumn[cls] < 0) firstMissing = true;
+        if (classes.secondColumn[cls] < 0) secondMissing = true;
+    }
+    vector<bool> canAccept1, canReject1, canAccept2, canReject2;
+    computeLiveness(first, firstMissing, canAccept1, canReject1);
+    computeLiveness(second, secondMissing, canAccept2, canReject2);
+
+    // A pair can still lead to acceptance only if its components allow it; NO_STATE is the sink
+    auto viable = [&](StateId a, StateId b) {
+        bool accept1 = a != NO_STATE && canAccept1[a];
+        bool accept2 = b != NO_STATE && canAccept2[b];
+        switch (op) {
+        case ProductOperation::Intersection: return accept1 && accept2;
+        case ProductOperation::Union: return accept1 || accept2;
+        case ProductOperation::Difference: return accept1 && (b == NO_STATE || canReject2[b]);
+        }
+        return false;
+    };
+    auto step = [](const Automaton& dfa, StateId s, int col) {
+        return s == NO_STATE || col < 0 ? NO_STATE : dfa.getTransition(s, (size_t)col);
+    };
+
+    // -------------------------------
+    // 2. BREADTH-FIRST SEARCH OVER REACHABLE, VIABLE PAIRS
+    // -------------------------------
+    PairTable ids;
+    vector<StateId> pairFirst, pairSecond;
+    vector<StateId> table;    // Pair id x joint class, NO_STATE for pruned successors
+    StateId start1 = n1 ? first.getStartState() : NO_STATE;
+    StateId start2 = n2 ? second.getStartState() : NO_STATE;
+    STATS_ONLY(uint64_t pruned = 0;)
+    if (viable(start1, start2)) {
+        bool added;
+        ids.find(PairTable::pack(start1, start2), 0, added);
+        pairFirst.push_back(start1);
+        pairSecond.push_back(start2);
+    }
+    for (size_t id = 0; id < pairFirst.size(); ++id) {
+        StateId a = pairFirst[id], b = pairSecond[id];
+        for (size_t cls = 0; cls < k; ++cls) {
+            StateId a2 = step(first, a, classes.firstColumn[cls]);
+            StateId b2 = step(second, b, classes.secondColumn[cls]);
+            if (!viable(a2, b2)) {
+                STATS_ONLY(++pruned;)
+                table.push_back(NO_STATE);
+                continue;
+            }
+            if (pairFirst.size() >= NO_STATE - 1) {
+                error = "the product has more than " + to_string(NO_STATE - 1) + " states";
+                return false;
+            }
+            bool added;
+            StateId next = ids.find(PairTable::pack(a2, b2), (StateId)pairFirst.size(), added);
+            if (added) {
+                pairFirst.push_back(a2);
+                pairSecond.push_back(b2);
+            }
+            table.push_back(next);
+        }
+    }
+    const StateId explored = (StateId)pairFirst.size();
+    STATS_ADD("product_pairs", explored);
+    STATS_ADD("product_pruned_edges", pruned);
+    STATS_BYTES("product_pairs", ids.memoryBytes() + vectorBytes(pairFirst) + vectorBytes(pairSecond) +
+                                 vectorBytes(table));
+
+    // -------------------------------
+    // 3. DROPPING PAIRS THAT CANNOT REACH ACCEPTANCE
+    // -------------------------------
+    vector<bool> accepting(explored), useful(explored);
+    for (StateId id = 0; id < explored; ++id) {
+        StateId a = pairFirst[id], b = pairSecond[id];
+        accepting[id] = combine(op, a != NO_STATE && first.isAccepting(a), b != NO_STATE && second.isAccepting(b));
+        useful[id] = accepting[id];
+    }
+    markBackward(table, explored, k, useful);
+
+    vector<StateId> newId(explored, NO_STATE);
+    StateId kept = 0;
+    for (StateId id = 0; id < explored; ++id) {
+        if (useful[id]) newId[id] = kept++;
+    }
+
+    // -------------------------------
+    // 4. THE RESULT: a partial DFA (one rejecting state if the language is empty)
+    // -------------------------------
+    result.setAlphabetClasses(classes.classOfSymbol);
+    result.initStates(max<StateId>(kept, 1));
+    result.setStartState(0);
+    for (StateId id = 0; id < explored; ++id) {
+        if (newId[id] == NO_STATE) continue;
+        result.setAccepting(newId[id], accepting[id]);
+        for (size_t cls = 0; cls < k; ++cls) {
+            StateId dest = table[(size_t)id * k + cls];
+            if (dest != NO_STATE && newId[dest] != NO_STATE) result.setTransition(newId[id], cls, newId[dest]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,111 @@
+#include "ResultCache.h"
+#include "BinaryFormat.h"
+#include "Stats.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+// Bumped whenever the cached results could change for the same input
+static const uint64_t CACHE_FORMAT = 1;
+
+Hash128 hashAutomaton(const Automaton& automaton, uint64_t seed) {
+    const StateId n = automaton.getNumStates();
+    Hasher128 hasher(seed);
+    hasher.updateValue((uint32_t)n);
+    hasher.updateValue((uint32_t)automaton.getNumColumns());
+    hasher.updateValue((uint32_t)automaton.getStartState());
+    int16_t columnOf[256];
+    for (int c = 0; c < 256; ++c) columnOf[c] = (int16_t)automaton.getColumn((char)c);
+    hasher.update(columnOf, sizeof(columnOf));
+
+    // Accepting states as a bitset, one word at a time
+    for (StateId base = 0; base < n; base += 64) {
+        uint64_t word = 0;
+        for (StateId s = base; s < n && s < base + 64; ++s) {
+            if (automaton.isAccepting(s)) word |= (uint64_t)1 << (s - base);
+        }
+        hasher.updateValue(word);
+    }
+    const vector<StateId>& table = automaton.getTransitionTable();
+    hasher.update(table.data(), table.size() * sizeof(StateId));
+    return hasher.finish();
+}
+
+ResultCache::ResultCache(const string& directory, size_t memoryLimit)
+    : directory(directory), memoryLimit(memoryLimit), memoryUsed(0), hits(0), misses(0) {}
+
+Hash128 ResultCache::key(const Automaton& input, bool partial) {
+    STATS_PHASE("cache_key");
+    return hashAutomaton(input, CACHE_FORMAT * 2 + (partial ? 1 : 0));
+}
+
+string ResultCache::pathOf(const Hash128& key) const {
+    return directory + "/" + key.toHex() + ".bin";
+}
+
+void ResultCache::remember(const Hash128& key, const Automaton& result) {
+    // Caller holds the lock
+    size_t bytes = result.getTransitionTable().size() * sizeof(StateId) + sizeof(Automaton);
+    if (bytes > memoryLimit || entries.count(key)) return;
+    while (memoryUsed + bytes > memoryLimit && !insertionOrder.empty()) {
+        auto oldest = entries.find(insertionOrder.front());
+        memoryUsed -= oldest->second.getTransitionTable().size() * sizeof(StateId) + sizeof(Automaton);
+        entries.erase(oldest);
+        insertionOrder.pop_front();
+    }
+    entries.emplace(key, result);
+    insertionOrder.push_back(key);
+    memoryUsed += bytes;
+}
+
+bool ResultCache::find(const Hash128& key, Automaton& result) {
+    STATS_PHASE("cache_lookup");
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            result = it->second;
+            ++hits;
+            return true;
+        }
+    }
+    // A file that cannot be mapped or fails validation counts as a miss and is
+    // overwritten by the next insert
+    string path = pathOf(key), error;
+    MappedAutomaton mapped;
+    if (!directory.empty() && isBinaryAutomatonFile(path) && mapped.open(path, error) && mapped.validate(error)) {
+        result = mapped.toAutomaton();
+        lock_guard<mutex> guard(lock);
+        remember(key, result);
+        ++hits;
+        return true;
+    }
+    ++misses;
+    return false;
+}
+
+bool ResultCache::insert(const Hash128& key, const Automaton& result, string& error) {
+    STATS_PHASE("cache_insert");
+    {
+        lock_guard<mutex> guard(lock);
+        remember(key, result);
+    }
+    if (directory.empty()) return true;
+
+    string path = pathOf(key);
+    string temporary = path + ".tmp" + to_string(hash<thread::id>()(this_thread::get_id()) ^
+                                                  (size_t)chrono::steady_clock::now().time_since_epoch().count());
+    if (!saveAutomatonBinary(result, temporary, error)) return false;
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        // Windows does not replace an existing file; another run stored the same result
+        remove(temporary.c_str());
+        if (!isBinaryAutomatonFile(path)) {
+            error = "cannot rename '" + temporary + "' to '" + path + "'";
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,102 @@
+#include "Snapshot.h"
+#include <algorithm>
+
+using namespace std;
+
+DfaSnapshot::DfaSnapshot(const Automaton& dfa, uint64_t version)
+    : version(version), sourceStates(dfa.getNumStates()), sourceColumns(dfa.getNumColumns()) {}
+
+bool DfaSnapshot::build(const Automaton& dfa, uint64_t version, unique_ptr<const DfaSnapshot>& snapshot,
+                        string& error) {
+    unique_ptr<DfaSnapshot> built(new DfaSnapshot(dfa, version));
+    if (!Matcher::compile(dfa, built->matcher, error)) return false;
+    snapshot = move(built);
+    return true;
+}
+
+// Epoch 0 marks an idle slot, so epochs start at 1
+SnapshotPublisher::SnapshotPublisher(unique_ptr<const DfaSnapshot> initial)
+    : current(initial.release()), epoch(1), slots(nullptr), reclaimedCount(0) {}
+
+SnapshotPublisher::~SnapshotPublisher() {
+    delete current.load();
+    for (const Retired& r : retired) delete r.snapshot;
+    ReaderSlot* slot = slots.load();
+    while (slot) {
+        ReaderSlot* next = slot->next;
+        delete slot;
+        slot = next;
+    }
+}
+
+SnapshotPublisher::ReaderSlot* SnapshotPublisher::claimSlot() {
+    // Reuse a slot released by a reader that has gone away
+    for (ReaderSlot* slot = slots.load(); slot; slot = slot->next) {
+        bool expected = false;
+        if (!slot->claimed.load() && slot->claimed.compare_exchange_strong(expected, true)) return slot;
+    }
+    ReaderSlot* slot = new ReaderSlot;
+    slot->pinned.store(0);
+    slot->claimed.store(true);
+    slot->next = slots.load();
+    while (!slots.compare_exchange_weak(slot->next, slot)) {}
+    return slot;
+}
+
+size_t SnapshotPublisher::publish(unique_ptr<const DfaSnapshot> next) {
+    lock_guard<mutex> guard(writerLock);
+    const DfaSnapshot* previous = current.exchange(next.release());
+    // A reader that sees this epoch or a later one loads `current` after the exchange
+    uint64_t retiredAt = epoch.fetch_add(1) + 1;
+    if (previous) retired.push_back({previous, retiredAt});
+    return reclaimLocked();
+}
+
+size_t SnapshotPublisher::reclaim() {
+    lock_guard<mutex> guard(writerLock);
+    return reclaimLocked();
+}
+
+size_t SnapshotPublisher::reclaimLocked() {
+    if (retired.empty()) return 0;
+    // Oldest epoch any reader is pinned at; a snapshot retired after it may still be held
+    uint64_t oldestPinned = UINT64_MAX;
+    for (ReaderSlot* slot = slots.load(); slot; slot = slot->next) {
+        uint64_t pinned = slot->pinned.load();
+        if (pinned != 0) oldestPinned = min(oldestPinned, pinned);
+    }
+    size_t kept = 0;
+    for (const Retired& r : retired) {
+        if (r.epoch <= oldestPinned) {
+            delete r.snapshot;
+            ++reclaimedCount;
+        } else {
+            retired[kept++] = r;
+        }
+    }
+    retired.resize(kept);
+    return kept;
+}
+
+uint64_t SnapshotPublisher::getReclaimed() {
+    lock_guard<mutex> guard(writerLock);
+    return reclaimedCount;
+}
+
+SnapshotReader::SnapshotReader(SnapshotPublisher& publisher) : publisher(publisher), slot(publisher.claimSlot()) {}
+
+SnapshotReader::~SnapshotReader() {
+    slot->pinned.store(0);
+    slot->claimed.store(false);
+}
+
+const DfaSnapshot* SnapshotReader::acquire() {
+    // Announce the epoch before loading the pointer (both sequentially consistent): if
+    // the writer's scan missed this store, the load below comes after its exchange
+    slot->pinned.store(publisher.epoch.load());
+    return publisher.current.load();
+}
+
+void SnapshotReader::release() {
+    slot->pinned.store(0, memory_order_release);
+}
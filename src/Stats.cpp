@@ -0,0 +1,172 @@
+#include "Stats.h"
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+using namespace std;
+
+static thread_local StatsReport* threadReport = nullptr;
+
+StatsReport::Value& StatsReport::find(vector<Value>& values, const char* name) {
+    for (Value& v : values) {
+        if (v.name == name) return v;
+    }
+    values.push_back(Value{name, 0});
+    return values.back();
+}
+
+void StatsReport::addPhase(const char* name, double wallSeconds, double cpuSeconds, uint64_t calls) {
+    for (Phase& phase : phases) {
+        if (phase.name == name) {
+            phase.calls += calls;
+            phase.wallSeconds += wallSeconds;
+            phase.cpuSeconds += cpuSeconds;
+            return;
+        }
+    }
+    phases.push_back(Phase{name, calls, wallSeconds, cpuSeconds});
+}
+
+void StatsReport::add(const char* name, uint64_t value) {
+    find(counters, name).value += value;
+}
+
+void StatsReport::peak(const char* name, uint64_t value) {
+    Value& v = find(peaks, name);
+    v.value = max(v.value, value);
+}
+
+void StatsReport::addBytes(const char* name, uint64_t size) {
+    Value& v = find(bytes, name);
+    v.value = max(v.value, size);
+}
+
+void StatsReport::merge(const StatsReport& other) {
+    for (const Phase& phase : other.phases) {
+        addPhase(phase.name.c_str(), phase.wallSeconds, phase.cpuSeconds, phase.calls);
+    }
+    for (const Value& v : other.counters) add(v.name.c_str(), v.value);
+    for (const Value& v : other.peaks) peak(v.name.c_str(), v.value);
+    for (const Value& v : other.bytes) addBytes(v.name.c_str(), v.value);
+}
+
+void StatsReport::writeJson(string& out) const {
+    char buffer[128];
+    auto writeValues = [&](const char* key, const vector<Value>& values) {
+        out += ",\n  \"";
+        out += key;
+        out += "\": {";
+        for (size_t i = 0; i < values.size(); ++i) {
+            snprintf(buffer, sizeof(buffer), "%s\n    \"%s\": %llu", i ? "," : "",
+                     values[i].name.c_str(), (unsigned long long)values[i].value);
+            out += buffer;
+        }
+        out += values.empty() ? "}" : "\n  }";
+    };
+
+    out += "{\n  \"stats_enabled\": ";
+    out += DFA_STATS ? "true" : "false";
+    out += ",\n  \"phases\": [";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        snprintf(buffer, sizeof(buffer),
+                 "%s\n    {\"name\": \"%s\", \"calls\": %llu, \"wall_s\": %.6f, \"cpu_s\": %.6f}",
+                 i ? "," : "", phases[i].name.c_str(), (unsigned long long)phases[i].calls,
+                 phases[i].wallSeconds, phases[i].cpuSeconds);
+        out += buffer;
+    }
+    out += phases.empty() ? "]" : "\n  ]";
+    writeValues("counters", counters);
+    writeValues("peaks", peaks);
+    writeValues("bytes", bytes);
+    snprintf(buffer, sizeof(buffer), ",\n  \"peak_rss_kb\": %ld\n}\n", peakRssKb());
+    out += buffer;
+}
+
+StatsReport* currentStats() {
+    return threadReport;
+}
+
+StatsScope::StatsScope(StatsReport* report) : previous(threadReport) {
+    threadReport = report;
+}
+
+StatsScope::~StatsScope() {
+    threadReport = previous;
+}
+
+PhaseTimer::PhaseTimer(const char* name) : report(threadReport), name(name) {
+    if (report) {
+        wallStart = chrono::steady_clock::now();
+        cpuStart = clock();
+    }
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (!report) return;
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    double cpu = (double)(clock() - cpuStart) / CLOCKS_PER_SEC;
+    report->addPhase(name, wall, cpu);
+}
+
+long peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (long)(counters.PeakWorkingSetSize / 1024);
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+}
+
+#ifdef __linux__
+CacheMissCounter::CacheMissCounter() {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+CacheMissCounter::~CacheMissCounter() {
+    if (fd >= 0) ::close(fd);
+}
+
+void CacheMissCounter::start() {
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+long long CacheMissCounter::stop() {
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long count;
+    if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) return -1;
+    return count;
+}
+#else
+CacheMissCounter::CacheMissCounter() : fd(-1) {}
+CacheMissCounter::~CacheMissCounter() {}
+void CacheMissCounter::start() {}
+long long CacheMissCounter::stop() { return -1; }
+#endif
@@ -1,6 +1,9 @@
 #include "Utils.h"
 #include <string>
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
 
 namespace utils {
     // Convert a set of states to a state name
@@ -16,4 +19,35 @@ namespace utils {
         name += "}";
         return name;
     }
-}
\ No newline at end of file
+
+    std::string symbolLabel(char symbol) {
+        unsigned char c = (unsigned char)symbol;
+        if (c <= ' ' || c >= 127 || c == '[' || c == ']' || c == '\\' || c == '#') {
+            char hex[5];
+            snprintf(hex, sizeof(hex), "\\x%02X", c);
+            return hex;
+        }
+        return std::string(1, symbol);
+    }
+
+    std::string symbolClassLabel(const std::vector<char>& symbols) {
+        if (symbols.size() == 1) return symbolLabel(symbols[0]);
+        std::vector<unsigned char> bytes(symbols.begin(), symbols.end());
+        std::sort(bytes.begin(), bytes.end());
+
+        // Runs of three or more consecutive bytes are written as ranges
+        std::string label = "[";
+        for (size_t i = 0; i < bytes.size();) {
+            size_t j = i;
+            while (j + 1 < bytes.size() && bytes[j + 1] == bytes[j] + 1) ++j;
+            label += symbolLabel((char)bytes[i]);
+            if (j - i >= 2) {
+                label += "-" + symbolLabel((char)bytes[j]);
+            } else if (j > i) {
+                label += symbolLabel((char)bytes[j]);
+            }
+            i = j + 1;
+        }
+        return label + "]";
+    }
+}
@@ -1,38 +1,415 @@
 #include "Automaton.h"
+#include "BatchMinimizer.h"
+#include "CodeGen.h"
+#include "Equivalence.h"
+#include "Export.h"
+#include "ExternalMinimizer.h"
+#include "Layout.h"
+#include "Loader.h"
+#include "BinaryFormat.h"
+#include "Matcher.h"
+#include "MappedFile.h"
+#include "Partition.h"
+#include "Product.h"
+#include "ResultCache.h"
+#include "Stats.h"
+#include "Utils.h"
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
 
 using namespace std;
 
-int main() {
+// Load a text or binary automaton file ("-" for stdin)
+static bool loadInput(const string& path, Automaton& automaton, string& error) {
+    if (path != "-" && isBinaryAutomatonFile(path)) {
+        STATS_PHASE("load");
+        MappedAutomaton mapped;
+        if (!mapped.open(path, error) || !mapped.validate(error)) return false;
+        automaton = mapped.toAutomaton();
+        return true;
+    }
+    return loadAutomatonFile(path, automaton, error);
+}
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [input] [-o output] [-j threads | -p] [-m file] [--export format file]\n"
+         << "       " << string(strlen(program), ' ') << " [--codegen style file] [--canonical] [--cache dir]\n"
+         << "       " << string(strlen(program), ' ') << " [--order bfs|dfs|profile] [--trace file] [--stats file]\n"
+         << "       " << program << " input --and|--or|--minus other [options as above]\n"
+         << "       " << program << " -b [input] [-o output] [-j threads] [-p] [--canonical] [--cache dir]\n"
+         << "       " << string(strlen(program) + 3, ' ') << " [--stats file]\n"
+         << "       " << program << " input -e other [--stats file]\n"
+         << "       " << program << " input --external budget -o output [--stats file]\n"
+         << "  input      text edge-list or binary automaton file, '-' for stdin\n"
+         << "             (prompts interactively when omitted); text 'nfa' records are\n"
+         << "             determinized by subset construction first\n"
+         << "  -o output  save the minimized DFA in the binary format\n"
+         << "  -j threads minimize with parallel signature refinement (0 = all cores)\n"
+         << "  -p         minimize as a partial DFA: no sink state is added and states that\n"
+         << "             cannot reach an accepting state are dropped\n"
+         << "  -m file    print the lines of file accepted by the minimized DFA\n"
+         << "  --export format file\n"
+         << "             write the minimized DFA as table, text (edge list), csv or dot\n"
+         << "             (Graphviz) to file, '-' for stdout\n"
+         << "  --codegen style file\n"
+         << "             write the minimized DFA as a standalone C++17 matcher header, with\n"
+         << "             constexpr tables (table) or a direct-coded state machine (switch)\n"
+         << "  --canonical\n"
+         << "             number the minimized DFA canonically: breadth-first from the start\n"
+         << "             state in alphabet order, so equal languages give identical output\n"
+         << "  --cache dir\n"
+         << "             reuse minimized DFAs stored in dir under a 128-bit hash of the\n"
+         << "             input, and store new ones there (implies --canonical)\n"
+         << "  --order bfs|dfs|profile\n"
+         << "             renumber the minimized DFA for cache locality: breadth-first or\n"
+         << "             depth-first from the start state, or most visited first when run\n"
+         << "             over a sample trace (--trace file, else the -m file)\n"
+         << "  -b         batch: minimize every record of a text stream (stdin if no input)\n"
+         << "             on -j worker threads and write the minimized records in input\n"
+         << "             order to the output file or stdout\n"
+         << "  --and, --or, --minus other\n"
+         << "             minimize the intersection, union or difference of input and other,\n"
+         << "             built from the reachable pairs that can still reach acceptance\n"
+         << "  --external budget\n"
+         << "             minimize a binary input out of core into the binary output, holding\n"
+         << "             one block ID per state and at most budget MiB in memory; the table\n"
+         << "             is read in passes and sorted signatures are spilled to temp files\n"
+         << "  -e other   check whether input and other accept the same language; prints a\n"
+         << "             shortest distinguishing string if not (exit status 2)\n"
+         << "  --stats file\n"
+         << "             write phase timings, counters and memory use as JSON ('-' for stderr)\n";
+}
+
+int main(int argc, char* argv[]) {
     Automaton automaton;
+    string inputPath, outputPath, matchPath, statsPath, otherPath, productPath, exportPath;
+    ExportFormat exportFormat = ExportFormat::Table;
+    string codePath;
+    CodeStyle codeStyle = CodeStyle::Table;
+    ProductOperation productOp = ProductOperation::Intersection;
+    int threads = -1; // Sequential Hopcroft unless -j is given
+    uint64_t externalBudget = 0; // MiB; nonzero selects out-of-core minimization
+    bool batch = false;
+    bool partial = false;
+    bool canonical = false;
+    string cacheDir;
+    bool reorder = false;
+    StateOrder stateOrder = StateOrder::BreadthFirst;
+    string tracePath;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-b") {
+            batch = true;
+        } else if (arg == "-p") {
+            partial = true;
+        } else if (arg == "--canonical") {
+            canonical = true;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (arg == "--order" && i + 1 < argc && parseStateOrder(argv[i + 1], stateOrder)) {
+            reorder = true;
+            ++i;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--export" && i + 2 < argc && parseExportFormat(argv[i + 1], exportFormat)) {
+            exportPath = argv[i + 2];
+            i += 2;
+        } else if (arg == "--codegen" && i + 2 < argc && parseCodeStyle(argv[i + 1], codeStyle)) {
+            codePath = argv[i + 2];
+            i += 2;
+        } else if (arg == "--stats" && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if ((arg == "--and" || arg == "--or" || arg == "--minus") && i + 1 < argc && productPath.empty()) {
+            productOp = arg == "--and" ? ProductOperation::Intersection
+                      : arg == "--or"  ? ProductOperation::Union
+                                       : ProductOperation::Difference;
+            productPath = argv[++i];
+        } else if (arg == "--external" && i + 1 < argc && strtoull(argv[i + 1], nullptr, 10) > 0) {
+            externalBudget = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-e" && i + 1 < argc) {
+            otherPath = argv[++i];
+        } else if (arg == "-m" && i + 1 < argc) {
+            matchPath = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (inputPath.empty() && (arg == "-" || arg[0] != '-')) {
+            inputPath = arg;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    StatsReport report;
+    StatsScope statsScope(statsPath.empty() ? nullptr : &report);
+    // Write the report at every exit below, failures included
+    auto finish = [&](int status) {
+        if (statsPath.empty()) return status;
+        string json;
+        report.writeJson(json);
+        FILE* file = statsPath == "-" ? stderr : fopen(statsPath.c_str(), "wb");
+        bool written = file && fwrite(json.data(), 1, json.size(), file) == json.size();
+        if (file && file != stderr && fclose(file) != 0) written = false;
+        if (!written) {
+            cerr << "Error: writing " << statsPath << " failed" << endl;
+            return 1;
+        }
+        return status;
+    };
+
+    // A layout order renumbers the one minimized DFA, so it excludes canonical numbering
+    // and the other modes; --trace only feeds the profile order
+    if (reorder || !tracePath.empty()) {
+        if (!reorder || canonical || !cacheDir.empty() || batch || externalBudget || !otherPath.empty()
+            || (stateOrder == StateOrder::Profile ? tracePath.empty() && matchPath.empty() : !tracePath.empty())) {
+            printUsage(argv[0]);
+            return finish(1);
+        }
+    }
+
+    if (!otherPath.empty()) {
+        // Equivalence check: the result goes to stdout, nothing is minimized
+        if (batch || inputPath.empty() || !outputPath.empty() || !matchPath.empty() || !productPath.empty()
+            || !exportPath.empty() || !codePath.empty() || canonical || !cacheDir.empty()) {
+            printUsage(argv[0]);
+            return finish(1);
+        }
+        Automaton other;
+        string error;
+        for (const string* path : {&inputPath, &otherPath}) {
+            if (!loadInput(*path, path == &inputPath ? automaton : other, error)) {
+                cerr << "Error loading " << *path << ": " << error << endl;
+                return finish(1);
+            }
+        }
+        string counterexample;
+        bool equivalent = false;
+        if (!checkEquivalence(automaton, other, equivalent, counterexample, error)) {
+            cerr << "Error: " << error << endl;
+            return finish(1);
+        }
+        if (equivalent) {
+            cout << "Equivalent\n";
+            return finish(0);
+        }
+        string label;
+        for (char symbol : counterexample) label += utils::symbolLabel(symbol);
+        cout << "Not equivalent: \"" << label << "\" (length " << counterexample.size()
+             << ") is accepted only by " << (acceptsString(automaton, counterexample) ? inputPath : otherPath)
+             << "\n";
+        return finish(2);
+    }
+
+    if (externalBudget) {
+        // Out-of-core minimization: binary file to binary file, the automaton is never loaded
+        if (batch || partial || threads >= 0 || inputPath.empty() || inputPath == "-" || outputPath.empty()
+            || !matchPath.empty() || !productPath.empty() || !exportPath.empty() || !codePath.empty()
+            || canonical || !cacheDir.empty()) {
+            printUsage(argv[0]);
+            return finish(1);
+        }
+        ExternalStats stats;
+        string error;
+        if (!minimizeExternal(inputPath, outputPath, externalBudget << 20, stats, error)) {
+            cerr << "Error: " << error << endl;
+            return finish(1);
+        }
+        cout << "Minimized " << inputPath << " out of core: " << stats.states << " states, "
+             << stats.reachableStates << " reachable, " << stats.minimalStates << " in the minimal DFA\n"
+             << "Rounds: " << stats.rounds << ", table passes: " << stats.tablePasses
+             << ", runs spilled: " << stats.runsSpilled << " (" << stats.mergePasses << " extra merge passes)\n"
+             << "Bytes read: " << stats.bytesRead << ", bytes written: " << stats.bytesWritten << "\n"
+             << "Peak resident: " << stats.residentBytes << " bytes of a " << (externalBudget << 20)
+             << "-byte budget (at least " << stats.requiredBytes << " needed)\n"
+             << "Saved minimized DFA to " << outputPath << endl;
+        return finish(0);
+    }
+
+    if (batch) {
+        // Batch mode: stdout carries the records, so only errors and the summary go to stderr
+        if (!matchPath.empty() || !productPath.empty() || !exportPath.empty() || !codePath.empty()) {
+            printUsage(argv[0]);
+            return finish(1);
+        }
+        Tokenizer in(inputPath.empty() ? "-" : inputPath);
+        FILE* out = outputPath.empty() ? stdout : fopen(outputPath.c_str(), "wb");
+        if (!in.isOpen() || !out) {
+            cerr << "Error: cannot open " << (!in.isOpen() ? inputPath : outputPath) << endl;
+            return finish(1);
+        }
+        unsigned workers = threads < 0 ? 0 : (unsigned)threads;
+        unsigned windowThreads = workers ? workers : max(1u, thread::hardware_concurrency());
+        BatchStats stats;
+        string error;
+        unique_ptr<ResultCache> cache(cacheDir.empty() ? nullptr : new ResultCache(cacheDir));
+        bool ok = minimizeBatch(in, out, workers, (size_t)windowThreads * 16, partial, canonical, cache.get(),
+                                stats, error);
+        if (out != stdout && fclose(out) != 0) ok = false;
+        if (!ok) {
+            cerr << "Error: " << (error.empty() ? "writing " + outputPath + " failed" : error) << endl;
+            return finish(1);
+        }
+        cerr << "Minimized " << stats.records - stats.failed << " of " << stats.records << " records";
+        if (stats.failed) cerr << " (" << stats.failed << " failed to load)";
+        if (cache) cerr << "; " << cache->getHits() << " found in the cache";
+        cerr << endl;
+        if (stats.cacheFailures) cerr << "Warning: " << stats.cacheFailures << " results could not be stored in " << cacheDir << endl;
+        return finish(stats.failed ? 2 : 0);
+    }
     
+    if ((partial && threads >= 0) || (!productPath.empty() && inputPath.empty())) {
+        printUsage(argv[0]);
+        return finish(1);
+    }
+
     cout << "DFA Minimization Tool\n";
     cout << "====================\n";
-    
-    automaton.inputAlphabet();
-    automaton.generateStates();
-    automaton.inputDeadStates();
-    automaton.inputAcceptingStates();
-    automaton.inputTransitions();
+
+    if (!inputPath.empty()) {
+        // Non-interactive: load the automaton from a file ("-" for stdin)
+        string error;
+        if (!loadInput(inputPath, automaton, error)) {
+            cerr << "Error loading " << inputPath << ": " << error << endl;
+            return finish(1);
+        }
+        if (!productPath.empty()) {
+            Automaton other, product;
+            if (!loadInput(productPath, other, error)) {
+                cerr << "Error loading " << productPath << ": " << error << endl;
+                return finish(1);
+            }
+            if (!buildProduct(automaton, other, productOp, product, error)) {
+                cerr << "Error: " << error << endl;
+                return finish(1);
+            }
+            automaton = move(product);
+            cout << "\nProduct with " << productPath << ": " << automaton.getNumStates() << " states\n";
+        }
+    } else {
+        automaton.inputAlphabet();
+        automaton.generateStates();
+        automaton.inputDeadStates();
+        automaton.inputAcceptingStates();
+        automaton.inputTransitions();
+    }
     
     cout << "\nOriginal DFA:";
     automaton.displayTransitionTable();
     
-    cout << "\nMinimizing DFA...\n";
-    
-    // Only remove unreachable states if they exist
-    if (automaton.hasUnreachableStates()) {
-        cout << "Removing unreachable states...\n";
-        automaton.removeUnreachableStates();
-        cout << "\nDFA after removing unreachable states:";
-        automaton.displayTransitionTable();
-    } else {
-        cout << "No unreachable states found.\n";
+    // An unchanged input is answered from the cache without minimizing it
+    unique_ptr<ResultCache> cache(cacheDir.empty() ? nullptr : new ResultCache(cacheDir));
+    Hash128 cacheKey;
+    Automaton minimizedDFA;
+    bool cached = false;
+    if (cache) {
+        cacheKey = ResultCache::key(automaton, partial);
+        cached = cache->find(cacheKey, minimizedDFA);
+        if (cached) cout << "\nFound the minimized DFA in " << cacheDir << " (" << cacheKey.toHex() << ").\n";
+    }
+
+    if (!cached) {
+        cout << "\nMinimizing DFA...\n";
+
+        // Only remove unreachable states if they exist
+        if (automaton.hasUnreachableStates()) {
+            cout << "Removing unreachable states...\n";
+            automaton.removeUnreachableStates();
+            cout << "\nDFA after removing unreachable states:";
+            automaton.displayTransitionTable();
+        } else {
+            cout << "No unreachable states found.\n";
+        }
+
+        if (partial) {
+            minimizedDFA = move(automaton).minimizePartialDFA();
+        } else if (threads >= 0) {
+            minimizedDFA = move(automaton).minimizeDFAParallel((unsigned)threads);
+        } else {
+            MinimizeScratch scratch;
+            automaton.minimizeInPlace(scratch);
+            minimizedDFA = move(automaton);
+        }
+        if (canonical || cache) minimizedDFA.canonicalize();
+        if (cache) {
+            string error;
+            if (!cache->insert(cacheKey, minimizedDFA, error)) {
+                cerr << "Warning: cannot store the result in " << cacheDir << ": " << error << endl;
+            } else {
+                cout << "Stored the minimized DFA in " << cacheDir << " (" << cacheKey.toHex() << ").\n";
+            }
+        }
+    }
+    if (reorder) {
+        vector<uint64_t> visits;
+        if (stateOrder == StateOrder::Profile) {
+            const string& path = tracePath.empty() ? matchPath : tracePath;
+            MappedFile trace;
+            string error;
+            if (!trace.open(path, error)) {
+                cerr << "Error reading " << path << ": " << error << endl;
+                return finish(1);
+            }
+            visits = profileStateVisits(minimizedDFA, trace.bytes(), trace.size());
+        }
+        reorderStates(minimizedDFA, stateOrder, visits);
+        cout << "\nRenumbered the states for cache locality ("
+             << (stateOrder == StateOrder::BreadthFirst ? "breadth-first"
+                 : stateOrder == StateOrder::DepthFirst ? "depth-first" : "profile") << " order).\n";
     }
-    
-    Automaton minimizedDFA = automaton.minimizeDFA();
     cout << "\nMinimized DFA:";
     minimizedDFA.displayTransitionTable();
+
+    if (!outputPath.empty()) {
+        string error;
+        if (!saveAutomatonBinary(minimizedDFA, outputPath, error)) {
+            cerr << "Error saving " << outputPath << ": " << error << endl;
+            return finish(1);
+        }
+        cout << "Saved minimized DFA to " << outputPath << endl;
+    }
+
+    if (!exportPath.empty()) {
+        string error;
+        if (!exportAutomatonFile(minimizedDFA, exportFormat, exportPath, error)) {
+            cerr << "Error: " << error << endl;
+            return finish(1);
+        }
+    }
+
+    if (!codePath.empty()) {
+        string error;
+        if (!generateCodeFile(minimizedDFA, codeStyle, codePath, error)) {
+            cerr << "Error: " << error << endl;
+            return finish(1);
+        }
+    }
+
+    if (!matchPath.empty()) {
+        Matcher matcher;
+        vector<uint64_t> lines;
+        string error;
+        if (!Matcher::compile(minimizedDFA, matcher, error)) {
+            cerr << "Error: " << error << endl;
+            return finish(1);
+        }
+        MappedFile file;
+        if (!matcher.scanFileLines(matchPath, lines, error) || (!lines.empty() && !file.open(matchPath, error))) {
+            cerr << "Error scanning " << matchPath << ": " << error << endl;
+            return finish(1);
+        }
+        cout << "\nLines of " << matchPath << " accepted by the minimized DFA: " << lines.size() << "\n";
+        for (uint64_t start : lines) {
+            const char* begin = (const char*)file.bytes() + start;
+            const char* end = (const char*)memchr(begin, '\n', file.size() - start);
+            cout.write(begin, end ? end - begin : (const char*)file.bytes() + file.size() - begin);
+            cout << '\n';
+        }
+    }
     
-    return 0;
+    return finish(0);
 }
\ No newline at end of file